@@ -0,0 +1,23 @@
+#ifndef KCOBAIN_ALLOC_COUNTER_H
+#define KCOBAIN_ALLOC_COUNTER_H
+
+#include <cstdint>
+
+// Build with -DKCOBAIN_ALLOC_COUNTER (CMake option KCOBAIN_ALLOC_COUNTER) to
+// replace the global operator new with a counting version. Without it the
+// counters below always read zero and allocation is untouched.
+
+namespace kcobain {
+
+// True when the counting operator new is compiled in
+bool isAllocCounterEnabled();
+
+// Heap allocations made so far by the calling thread
+uint64_t getThreadAllocCount();
+
+// Heap allocations made so far by all threads
+uint64_t getTotalAllocCount();
+
+} // namespace kcobain
+
+#endif // KCOBAIN_ALLOC_COUNTER_H
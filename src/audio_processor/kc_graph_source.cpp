@@ -0,0 +1,155 @@
+#include "kc_graph_source.h"
+#include "../../include/kcobain/logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace kcobain {
+namespace audio_processor {
+
+// Constructor
+kc_graph_source::kc_graph_source()
+    : graph(nullptr), block_valid(0), block_cursor(0), started_graph(false), blocks_read(0), short_blocks(0),
+      starved_microframes(0) {
+}
+
+// Destructor
+kc_graph_source::~kc_graph_source() {
+    stop();
+}
+
+// Initialize the bridge
+bool kc_graph_source::initialize(kc_node_graph* pGraph, const kc_graph_source_config& sourceConfig) {
+    if (!pGraph || !pGraph->is_initialized()) {
+        LOG_ERROR("Cannot initialize graph source - graph not initialized");
+        return false;
+    }
+    
+    if (sourceConfig.blockFrames == 0 || sourceConfig.channels == 0) {
+        LOG_ERROR("Cannot initialize graph source - invalid block size or channel count");
+        return false;
+    }
+    
+    // The graph writes its own channel count per frame into the block
+    ma_uint32 graphChannels = ma_node_graph_get_channels(pGraph->get_ma_graph());
+    if (graphChannels != sourceConfig.channels) {
+        LOG_ERROR("Cannot initialize graph source - graph outputs " + std::to_string(graphChannels) + 
+                  " channels, source configured for " + std::to_string(sourceConfig.channels));
+        return false;
+    }
+    
+    graph = pGraph;
+    config = sourceConfig;
+    
+    // The only allocation: every later read reuses this block
+    block.assign(static_cast<size_t>(config.blockFrames) * graphChannels, 0.0f);
+    block_valid = 0;
+    block_cursor = config.blockFrames;
+    
+    LOG_INFO("🔗 Graph source: " + std::to_string(config.blockFrames) + " frames per graph read, " + 
+             std::to_string(config.channels) + " channels");
+    return true;
+}
+
+// Check if the bridge is initialized
+bool kc_graph_source::is_initialized() const {
+    return graph != nullptr;
+}
+
+// Start pulling
+bool kc_graph_source::start() {
+    if (!is_initialized()) {
+        LOG_ERROR("Cannot start graph source - not initialized");
+        return false;
+    }
+    
+    if (!graph->is_running()) {
+        if (!graph->start()) {
+            return false;
+        }
+        started_graph = true;
+    }
+    
+    // Start from a fresh graph read
+    block_valid = 0;
+    block_cursor = config.blockFrames;
+    return true;
+}
+
+// Stop pulling
+void kc_graph_source::stop() {
+    if (started_graph && graph) {
+        graph->stop();
+    }
+    started_graph = false;
+}
+
+// Refill the block from the graph
+void kc_graph_source::pull_block() {
+    ma_uint32 framesRead = graph->read_pcm_frames(block.data(), config.blockFrames);
+    blocks_read.fetch_add(1, std::memory_order_relaxed);
+    
+    // A short read (graph ended, nothing attached) is padded so the block is always whole
+    if (framesRead < config.blockFrames) {
+        short_blocks.fetch_add(1, std::memory_order_relaxed);
+        std::memset(block.data() + static_cast<size_t>(framesRead) * config.channels, 0, 
+                    static_cast<size_t>(config.blockFrames - framesRead) * config.channels * sizeof(float));
+    }
+    block_valid = framesRead;
+    block_cursor = 0;
+}
+
+// Pack microframes from graph blocks
+void kc_graph_source::fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) {
+    const size_t bytesPerFrame = config.channels * sizeof(float);
+    const size_t framesPerSlot = std::min(payloadBytes, slotStride) / bytesPerFrame;
+    const size_t filledBytes = framesPerSlot * bytesPerFrame;
+    
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        uint8_t* slot = slots + frame * slotStride;
+        bool starved = false;
+        
+        // A microframe may straddle two blocks
+        size_t copied = 0;
+        while (copied < framesPerSlot) {
+            if (block_cursor == config.blockFrames) {
+                pull_block();
+            }
+            size_t chunk = std::min(framesPerSlot - copied, static_cast<size_t>(config.blockFrames - block_cursor));
+            if (block_cursor + chunk > block_valid) {
+                starved = true;
+            }
+            std::memcpy(slot + copied * bytesPerFrame, block.data() + static_cast<size_t>(block_cursor) * config.channels,
+                        chunk * bytesPerFrame);
+            block_cursor += static_cast<ma_uint32>(chunk);
+            copied += chunk;
+        }
+        
+        if (starved) {
+            starved_microframes.fetch_add(1, std::memory_order_relaxed);
+        }
+        std::memset(slot + filledBytes, 0, slotStride - filledBytes);
+    }
+}
+
+// Source name
+const char* kc_graph_source::getName() const {
+    return "node graph";
+}
+
+// Microframes that carried padding from a short graph read
+uint64_t kc_graph_source::getStarvedMicroframes() const {
+    return starved_microframes.load();
+}
+
+// Get blocks read
+ma_uint64 kc_graph_source::get_blocks_read() const {
+    return blocks_read.load();
+}
+
+// Get short blocks
+ma_uint64 kc_graph_source::get_short_blocks() const {
+    return short_blocks.load();
+}
+
+} // namespace audio_processor
+} // namespace kcobain
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "kc_node_graph.h"
+#include "../core/iaudio_source.h"
+#include <atomic>
+#include <vector>
+
+namespace kcobain {
+namespace audio_processor {
+
+// Graph source configuration
+struct kc_graph_source_config {
+    ma_uint32 blockFrames;        // Sample frames pulled from the graph per read
+    ma_uint32 channels;           // Must match the graph output and the microframe payload
+    
+    kc_graph_source_config() : blockFrames(768), channels(2) {}
+};
+
+// Bridge from a kc_node_graph into the USB producer: the producer thread
+// pulls fixed-size blocks from the graph (decoder → DSP runs there) and
+// packs them into microframes. One graph read covers many microframes -
+// 768 frames is 64 microframes at 96 kHz - so the per-read graph overhead
+// is amortised, and the block buffer is allocated once at initialize.
+// The graph must already produce the microframe sample rate.
+class kc_graph_source : public iaudio_source {
+public:
+    kc_graph_source();
+    ~kc_graph_source();
+    
+    bool initialize(kc_node_graph* pGraph, const kc_graph_source_config& config);
+    bool is_initialized() const;
+    
+    // iaudio_source
+    bool start() override;
+    void stop() override;
+    void fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) override;
+    const char* getName() const override;
+    uint64_t getStarvedMicroframes() const override;
+    
+    // Statistics
+    ma_uint64 get_blocks_read() const;
+    ma_uint64 get_short_blocks() const;     // Reads that came back with fewer frames than asked
+    
+private:
+    kc_node_graph* graph;                   // Not owned
+    kc_graph_source_config config;
+    std::vector<float> block;               // One block of interleaved samples
+    ma_uint32 block_valid;                  // Frames the last read returned
+    ma_uint32 block_cursor;                 // Next frame to pack
+    bool started_graph;                     // start() started the graph, so stop() stops it
+    
+    std::atomic<ma_uint64> blocks_read;
+    std::atomic<ma_uint64> short_blocks;
+    std::atomic<ma_uint64> starved_microframes;
+    
+    void pull_block();
+};
+
+} // namespace audio_processor
+} // namespace kcobain
@@ -76,7 +76,7 @@ bool kc_node_graph::is_initialized() const {
 }
 
 // Add decoder node (placeholder - will be implemented)
-bool kc_node_graph::add_decoder_node(const std::string& filename, kc_decoder_node** ppNode) {
+bool kc_node_graph::add_decoder_node(const std::string& filename, kc_decoder_node** /*ppNode*/) {
     if (!initialized) {
         LOG_ERROR("Cannot add decoder node - graph not initialized");
         return false;
@@ -95,7 +95,7 @@ bool kc_node_graph::add_decoder_node(const std::string& filename, kc_decoder_nod
 }
 
 // Add gain node (placeholder - will be implemented)
-bool kc_node_graph::add_gain_node(float gain, kc_gain_node** ppNode) {
+bool kc_node_graph::add_gain_node(float gain, kc_gain_node** /*ppNode*/) {
     if (!initialized) {
         LOG_ERROR("Cannot add gain node - graph not initialized");
         return false;
@@ -111,7 +111,7 @@ bool kc_node_graph::add_gain_node(float gain, kc_gain_node** ppNode) {
 }
 
 // Add filter node (placeholder - will be implemented)
-bool kc_node_graph::add_filter_node(int filterType, float frequency, float q, kc_filter_node** ppNode) {
+bool kc_node_graph::add_filter_node(int filterType, float frequency, float q, kc_filter_node** /*ppNode*/) {
     if (!initialized) {
         LOG_ERROR("Cannot add filter node - graph not initialized");
         return false;
@@ -159,7 +159,8 @@ bool kc_node_graph::connect_nodes(ma_node* pSourceNode, ma_uint32 sourceBus, ma_
 }
 
 // Disconnect nodes
-bool kc_node_graph::disconnect_nodes(ma_node* pSourceNode, ma_uint32 sourceBus, ma_node* pTargetNode, ma_uint32 targetBus) {
+bool kc_node_graph::disconnect_nodes(ma_node* /*pSourceNode*/, ma_uint32 /*sourceBus*/, ma_node* /*pTargetNode*/,
+                                     ma_uint32 /*targetBus*/) {
     if (!initialized) {
         LOG_ERROR("Cannot disconnect nodes - graph not initialized");
         return false;
@@ -184,13 +185,17 @@ ma_uint32 kc_node_graph::read_pcm_frames(float* pFramesOut, ma_uint32 frameCount
         return 0;
     }
     
-    ma_uint32 framesRead = ma_node_graph_read_pcm_frames(&graph, pFramesOut, frameCount, NULL);
+    // The result code is not a frame count; the count comes back through the last argument
+    ma_uint64 framesRead = 0;
+    ma_result result = ma_node_graph_read_pcm_frames(&graph, pFramesOut, frameCount, &framesRead);
     
-    if (framesRead == 0) {
+    if (result != MA_SUCCESS && result != MA_AT_END) {
+        LOG_WARN("Graph read failed: " + std::to_string(result));
+    } else if (framesRead == 0) {
         LOG_WARN("No frames read from graph");
     }
     
-    return framesRead;
+    return static_cast<ma_uint32>(framesRead);
 }
 
 // Start the graph
@@ -245,7 +250,8 @@ bool kc_node_graph::is_acyclic() const {
 }
 
 // Validate node connection
-bool kc_node_graph::validate_node_connection(ma_node* pSourceNode, ma_uint32 sourceBus, ma_node* pTargetNode, ma_uint32 targetBus) {
+bool kc_node_graph::validate_node_connection(ma_node* pSourceNode, ma_uint32 /*sourceBus*/, ma_node* pTargetNode,
+                                             ma_uint32 /*targetBus*/) {
     if (!pSourceNode || !pTargetNode) {
         return false;
     }
@@ -0,0 +1,321 @@
+#include "audio_capture.h"
+#include "audio_wait_strategy.h"
+#include "../../include/kcobain/logger.h"
+#include "../../external/miniaudio.h"
+#include <chrono>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_MMAP
+#endif
+
+namespace kcobain {
+
+static_assert(sizeof(audio_capture_file_header) == 40, "capture file header layout changed");
+static_assert(sizeof(audio_capture_record_header) == 32, "capture record header layout changed");
+
+audio_capture_writer::audio_capture_writer()
+    : file(nullptr), file_buffer(nullptr), staging_memory(nullptr), record_slot_bytes(0), max_payload_bytes(0),
+      running(false), records_written(0), records_dropped(0), bytes_written(0), write_failed(false) {
+}
+
+audio_capture_writer::~audio_capture_writer() {
+    close();
+}
+
+bool audio_capture_writer::open(const std::string& path, const audio_microframe_format& format, size_t slotBytes,
+                                const audio_capture_config& captureConfig) {
+    close();
+
+    if (path.empty() || slotBytes == 0 || captureConfig.stagingRecords == 0 || !format.isValid()) {
+        LOG_ERROR("Cannot open capture - invalid configuration");
+        return false;
+    }
+    config = captureConfig;
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Failed to create capture file " + path);
+        return false;
+    }
+    if (config.fileBufferBytes > 0) {
+        file_buffer = new char[config.fileBufferBytes];
+        std::setvbuf(file, file_buffer, _IOFBF, config.fileBufferBytes);
+    }
+
+    // Staging slots are whole records, so the consumer does one copy per microframe
+    max_payload_bytes = slotBytes;
+    record_slot_bytes = sizeof(audio_capture_record_header) + slotBytes;
+    record_slot_bytes = (record_slot_bytes + 7) & ~static_cast<size_t>(7);
+    staging_memory = ma_aligned_malloc(record_slot_bytes * config.stagingRecords, KCOBAIN_CACHE_LINE_SIZE, NULL);
+    if (!staging_memory || !staging.initialize(staging_memory, record_slot_bytes, config.stagingRecords, false)) {
+        LOG_ERROR("Failed to allocate " + std::to_string(config.stagingRecords) + " capture staging records");
+        close();
+        return false;
+    }
+    // Touch the staging memory now rather than on the consumer's first appends
+    std::memset(staging_memory, 0, record_slot_bytes * config.stagingRecords);
+
+    audio_capture_file_header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = audio_capture_file_header::MAGIC;
+    header.version = audio_capture_file_header::VERSION;
+    header.start_time_ns = audio_steady_time_ns();
+    header.sample_rate = format.sampleRate;
+    header.microframes_per_second = format.microframesPerSecond;
+    header.slot_bytes = static_cast<uint32_t>(slotBytes);
+    header.channels = format.channels;
+    header.subslot_bytes = format.subslotBytes;
+    header.bit_resolution = format.bitResolution;
+    header.encoding = static_cast<uint8_t>(format.encoding);
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        LOG_ERROR("Failed to write capture header to " + path);
+        close();
+        return false;
+    }
+
+    records_written = 0;
+    records_dropped = 0;
+    bytes_written = sizeof(header);
+    write_failed = false;
+    running = true;
+    writer_thread = std::thread([this]() { writerLoop(); });
+
+    LOG_INFO("🎙️ Capturing microframes to " + path + " (" + format.describe() + ", " +
+             std::to_string(config.stagingRecords) + " staged records)");
+    return true;
+}
+
+void audio_capture_writer::close() {
+    if (running.load()) {
+        running = false;
+        if (writer_thread.joinable()) {
+            writer_thread.join();
+        }
+    }
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+        LOG_INFO("🎙️ Capture closed: " + std::to_string(records_written.load()) + " microframes, " +
+                 std::to_string(bytes_written.load()) + " bytes, " + std::to_string(records_dropped.load()) + " dropped");
+    }
+    delete[] file_buffer;
+    file_buffer = nullptr;
+    staging.uninitialize();
+    if (staging_memory) {
+        ma_aligned_free(staging_memory, NULL);
+        staging_memory = nullptr;
+    }
+}
+
+bool audio_capture_writer::isOpen() const {
+    return file != nullptr;
+}
+
+bool audio_capture_writer::append(const audio_capture_record_header& header, const void* pPayload) {
+    size_t frames = 1;
+    void* slot = nullptr;
+    if (!running.load(std::memory_order_relaxed) || staging.acquireWriteFrames(&frames, &slot) != MA_SUCCESS ||
+        frames == 0) {
+        records_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    audio_capture_record_header record = header;
+    if (record.payload_bytes > max_payload_bytes) record.payload_bytes = static_cast<uint32_t>(max_payload_bytes);
+    std::memcpy(slot, &record, sizeof(record));
+    std::memcpy(static_cast<uint8_t*>(slot) + sizeof(record), pPayload, record.payload_bytes);
+    staging.commitWriteFrames(1);
+    return true;
+}
+
+size_t audio_capture_writer::drain() {
+    size_t total = 0;
+    for (;;) {
+        size_t frames = staging.getFrameCount();
+        void* slots = nullptr;
+        if (staging.acquireReadFrames(&frames, &slots) != MA_SUCCESS || frames == 0) break;
+
+        // Records go out compacted: header plus the packet, no slot padding
+        size_t written = 0;
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < frames; ++i) {
+            const uint8_t* slot = static_cast<const uint8_t*>(slots) + i * record_slot_bytes;
+            audio_capture_record_header record;
+            std::memcpy(&record, slot, sizeof(record));
+            size_t recordBytes = sizeof(record) + record.payload_bytes;
+            if (!write_failed.load(std::memory_order_relaxed) && std::fwrite(slot, recordBytes, 1, file) != 1) {
+                write_failed = true;
+                LOG_ERROR("Capture write failed - further microframes are dropped");
+            }
+            if (write_failed.load(std::memory_order_relaxed)) {
+                records_dropped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                bytes += recordBytes;
+                ++written;
+            }
+        }
+        staging.commitReadFrames(frames);
+        records_written.fetch_add(written, std::memory_order_relaxed);
+        bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+        total += written;
+    }
+    return total;
+}
+
+void audio_capture_writer::writerLoop() {
+    const std::chrono::microseconds period(config.drainMicros > 0 ? config.drainMicros : 1);
+    while (running.load()) {
+        drain();
+        std::this_thread::sleep_for(period);
+    }
+    // The consumer has stopped appending (or will only be dropping now): flush the rest
+    drain();
+    std::fflush(file);
+}
+
+uint64_t audio_capture_writer::getRecordsWritten() const {
+    return records_written.load();
+}
+
+uint64_t audio_capture_writer::getRecordsDropped() const {
+    return records_dropped.load();
+}
+
+uint64_t audio_capture_writer::getBytesWritten() const {
+    return bytes_written.load();
+}
+
+audio_capture_reader::audio_capture_reader()
+    : mapping(nullptr), mapping_bytes(0), records(nullptr), records_bytes(0), position(0), record_count(0) {
+    std::memset(&header, 0, sizeof(header));
+}
+
+audio_capture_reader::~audio_capture_reader() {
+    close();
+}
+
+bool audio_capture_reader::open(const std::string& path) {
+#ifdef KCOBAIN_HAS_MMAP
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open capture " + path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(audio_capture_file_header)) {
+        LOG_ERROR(path + " is too short to be a capture");
+        ::close(fd);
+        return false;
+    }
+    mapping_bytes = static_cast<size_t>(info.st_size);
+    void* p = mmap(NULL, mapping_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("Failed to map capture " + path);
+        mapping_bytes = 0;
+        return false;
+    }
+    mapping = p;
+    madvise(mapping, mapping_bytes, MADV_SEQUENTIAL);
+
+    const uint8_t* file = static_cast<const uint8_t*>(mapping);
+    std::memcpy(&header, file, sizeof(header));
+    if (header.magic != audio_capture_file_header::MAGIC || header.version != audio_capture_file_header::VERSION) {
+        LOG_ERROR(path + " is not a version " + std::to_string(audio_capture_file_header::VERSION) + " capture");
+        close();
+        return false;
+    }
+    format = header.encoding == static_cast<uint8_t>(audio_sample_encoding::ieee_float)
+                 ? audio_microframe_format::float32(header.sample_rate, header.channels)
+                 : audio_microframe_format::pcm(header.sample_rate, header.channels, header.subslot_bytes,
+                                                header.bit_resolution);
+    format.microframesPerSecond = header.microframes_per_second;
+    if (!format.isValid()) {
+        LOG_ERROR(path + " describes an invalid microframe format");
+        close();
+        return false;
+    }
+
+    // Count the complete records; a torn tail from a crashed writer is ignored
+    records = file + sizeof(header);
+    size_t available = mapping_bytes - sizeof(header);
+    size_t offset = 0;
+    record_count = 0;
+    while (available - offset >= sizeof(audio_capture_record_header)) {
+        audio_capture_record_header record;
+        std::memcpy(&record, records + offset, sizeof(record));
+        size_t recordBytes = sizeof(record) + record.payload_bytes;
+        if (record.payload_bytes > header.slot_bytes || available - offset < recordBytes) break;
+        offset += recordBytes;
+        ++record_count;
+    }
+    records_bytes = offset;
+    if (offset < available) {
+        LOG_WARN(path + " ends in a partial record - " + std::to_string(available - offset) + " bytes ignored");
+    }
+    position = 0;
+
+    LOG_INFO("🎙️ Capture " + path + ": " + std::to_string(record_count) + " microframes, " + format.describe());
+    return true;
+#else
+    (void)path;
+    LOG_ERROR("Capture replay is not supported on this platform");
+    return false;
+#endif
+}
+
+void audio_capture_reader::close() {
+#ifdef KCOBAIN_HAS_MMAP
+    if (mapping) {
+        munmap(mapping, mapping_bytes);
+    }
+#endif
+    mapping = nullptr;
+    mapping_bytes = 0;
+    records = nullptr;
+    records_bytes = 0;
+    position = 0;
+    record_count = 0;
+}
+
+bool audio_capture_reader::isOpen() const {
+    return mapping != nullptr;
+}
+
+bool audio_capture_reader::next(audio_capture_record* pRecord) {
+    if (!records || position >= records_bytes) return false;
+    // Records are packed back to back, so the header is copied out rather than cast
+    std::memcpy(&pRecord->header, records + position, sizeof(pRecord->header));
+    pRecord->payload = records + position + sizeof(pRecord->header);
+    position += sizeof(pRecord->header) + pRecord->header.payload_bytes;
+    return true;
+}
+
+void audio_capture_reader::rewind() {
+    position = 0;
+}
+
+const audio_microframe_format& audio_capture_reader::getFormat() const {
+    return format;
+}
+
+size_t audio_capture_reader::getSlotBytes() const {
+    return header.slot_bytes;
+}
+
+uint64_t audio_capture_reader::getRecordCount() const {
+    return record_count;
+}
+
+int64_t audio_capture_reader::getStartTimeNs() const {
+    return header.start_time_ns;
+}
+
+} // namespace kcobain
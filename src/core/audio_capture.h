@@ -0,0 +1,152 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "audio_frame_ring.h"
+#include "audio_sample_format.h"
+
+namespace kcobain {
+
+/**
+ * @brief Capture file header
+ * A capture is this header followed by records appended in the order the
+ * consumer read them. Fields are in host byte order (little endian on every
+ * supported target).
+ */
+struct audio_capture_file_header {
+    static const uint32_t MAGIC = 0x5041434bu;  // "KCAP"
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    int64_t start_time_ns;          // Steady clock when the capture was opened
+    uint32_t sample_rate;
+    uint32_t microframes_per_second;
+    uint32_t slot_bytes;            // Ring slot size at capture time
+    uint16_t channels;
+    uint8_t subslot_bytes;
+    uint8_t bit_resolution;
+    uint8_t encoding;               // audio_sample_encoding
+    uint8_t reserved[7];
+};
+
+/**
+ * @brief One captured microframe, followed by payload_bytes of payload
+ * Only the packet is stored, not the slot padding.
+ */
+struct audio_capture_record_header {
+    static const uint16_t FLAG_FRAME_META = 1;  // sequence/commit_time_ns came from the slot metadata
+
+    uint64_t sequence;              // Producer sequence, or the consumer's own count without metadata
+    int64_t commit_time_ns;         // Producer commit time (metadata), else equal to read_time_ns
+    int64_t read_time_ns;           // When the consumer read the slot
+    uint32_t payload_bytes;
+    uint16_t lane;
+    uint16_t flags;
+};
+
+/**
+ * @brief A record handed out by audio_capture_reader
+ */
+struct audio_capture_record {
+    audio_capture_record_header header;
+    const uint8_t* payload;         // Points into the mapped capture
+
+    audio_capture_record() : header(), payload(nullptr) {}
+};
+
+/**
+ * @brief Capture writer configuration
+ */
+struct audio_capture_config {
+    size_t stagingRecords;          // Microframes buffered between the consumer and the disk
+    uint32_t drainMicros;           // Writer thread poll period
+    size_t fileBufferBytes;         // stdio buffer for the capture file
+
+    audio_capture_config() : stagingRecords(4096), drainMicros(2000), fileBufferBytes(1 << 20) {}
+};
+
+/**
+ * @brief Append-only microframe capture, off the consumer's critical path
+ * The consumer copies each microframe it reads into a preallocated SPSC
+ * staging ring; a writer thread drains the ring to the file. append() never
+ * blocks, takes no locks and makes no system calls; when the disk falls
+ * behind and the staging ring is full the record is dropped and counted.
+ */
+class audio_capture_writer {
+private:
+    audio_capture_config config;
+    std::FILE* file;
+    char* file_buffer;
+    void* staging_memory;
+    audio_frame_ring staging;       // Slots are a record header plus a full ring slot
+    size_t record_slot_bytes;
+    size_t max_payload_bytes;
+    std::thread writer_thread;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> records_written;
+    std::atomic<uint64_t> records_dropped;
+    std::atomic<uint64_t> bytes_written;
+    std::atomic<bool> write_failed;
+
+    void writerLoop();
+    size_t drain();                 // Writes out whatever is staged; returns records written
+
+public:
+    audio_capture_writer();
+    ~audio_capture_writer();
+
+    // slotBytes is the ring slot size: the largest payload a record can carry
+    bool open(const std::string& path, const audio_microframe_format& format, size_t slotBytes,
+              const audio_capture_config& captureConfig = audio_capture_config());
+    // Stops the writer thread after it has flushed everything staged
+    void close();
+    bool isOpen() const;
+
+    // Consumer thread only
+    bool append(const audio_capture_record_header& header, const void* pPayload);
+
+    uint64_t getRecordsWritten() const;
+    uint64_t getRecordsDropped() const;
+    uint64_t getBytesWritten() const;
+};
+
+/**
+ * @brief Reads a capture back
+ * Maps the file read-only and walks the records in place. A capture cut
+ * short (the process died mid-write) ends at its last complete record.
+ */
+class audio_capture_reader {
+private:
+    void* mapping;
+    size_t mapping_bytes;
+    const uint8_t* records;
+    size_t records_bytes;           // Complete records only
+    size_t position;
+    uint64_t record_count;
+    audio_capture_file_header header;
+    audio_microframe_format format;
+
+public:
+    audio_capture_reader();
+    ~audio_capture_reader();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Next record in capture order; false at the end
+    bool next(audio_capture_record* pRecord);
+    void rewind();
+
+    const audio_microframe_format& getFormat() const;
+    size_t getSlotBytes() const;
+    uint64_t getRecordCount() const;
+    int64_t getStartTimeNs() const;
+};
+
+} // namespace kcobain
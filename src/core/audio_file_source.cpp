@@ -0,0 +1,244 @@
+#include "audio_file_source.h"
+#include "audio_wait_strategy.h"
+#include "../../include/kcobain/logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace kcobain {
+
+namespace {
+
+// How long start() waits for the read-ahead to fill before streaming anyway
+const int PRIME_TIMEOUT_MILLIS = 2000;
+
+} // namespace
+
+audio_file_source::audio_file_source()
+    : decoder_ready(false), read_ahead_ready(false), running(false), end_of_stream(false), starved_microframes(0),
+      decoded_frames(0), loop_count(0), max_decode_ns(0), decoded_since_rewind(0) {
+}
+
+audio_file_source::~audio_file_source() {
+    uninitialize();
+}
+
+bool audio_file_source::initialize(const audio_file_source_config& sourceConfig) {
+    uninitialize();
+    
+    if (sourceConfig.path.empty() || sourceConfig.sampleRate == 0 || sourceConfig.channels == 0 || 
+        sourceConfig.decodeChunkFrames == 0) {
+        LOG_ERROR("Cannot initialize file source - invalid configuration");
+        return false;
+    }
+    config = sourceConfig;
+    
+    // Decode straight to the microframe payload format; the decoder converts and resamples
+    ma_decoder_config decoderConfig = ma_decoder_config_init(ma_format_f32, config.channels, config.sampleRate);
+    ma_result result = ma_decoder_init_file(config.path.c_str(), &decoderConfig, &decoder);
+    if (result != MA_SUCCESS) {
+        LOG_ERROR("Failed to open " + config.path + " for decoding (result: " + std::to_string(result) + ")");
+        return false;
+    }
+    decoder_ready = true;
+    
+    // At least two decoder chunks so one can be decoded while the other drains
+    ma_uint32 readAheadFrames = static_cast<ma_uint32>(
+        std::max<uint64_t>(static_cast<uint64_t>(config.sampleRate) * config.readAheadMillis / 1000,
+                           static_cast<uint64_t>(config.decodeChunkFrames) * 2));
+    result = ma_pcm_rb_init(ma_format_f32, config.channels, readAheadFrames, NULL, NULL, &read_ahead);
+    if (result != MA_SUCCESS) {
+        LOG_ERROR("Failed to allocate file source read-ahead (" + std::to_string(readAheadFrames) + " frames)");
+        uninitialize();
+        return false;
+    }
+    read_ahead_ready = true;
+    
+    size_t slash = config.path.find_last_of("/\\");
+    name = slash == std::string::npos ? config.path : config.path.substr(slash + 1);
+    
+    ma_uint64 lengthFrames = 0;
+    ma_decoder_get_length_in_pcm_frames(&decoder, &lengthFrames);
+    LOG_INFO("📀 File source: " + name + ", " + std::to_string(lengthFrames) + " frames at " + 
+             std::to_string(config.sampleRate) + " Hz, read-ahead " + std::to_string(readAheadFrames) + " frames");
+    return true;
+}
+
+void audio_file_source::uninitialize() {
+    stop();
+    if (read_ahead_ready) {
+        ma_pcm_rb_uninit(&read_ahead);
+        read_ahead_ready = false;
+    }
+    if (decoder_ready) {
+        ma_decoder_uninit(&decoder);
+        decoder_ready = false;
+    }
+}
+
+bool audio_file_source::isInitialized() const {
+    return decoder_ready && read_ahead_ready;
+}
+
+bool audio_file_source::start() {
+    if (running.load()) return true;
+    
+    if (!isInitialized()) {
+        LOG_ERROR("Cannot start file source - not initialized");
+        return false;
+    }
+    
+    // A source that played to its end starts over; one stopped mid-file resumes where it was
+    if (end_of_stream.load()) {
+        ma_result result = ma_decoder_seek_to_pcm_frame(&decoder, 0);
+        if (result != MA_SUCCESS) {
+            LOG_ERROR("Cannot restart file source - " + name + " cannot seek back to the start (result: " +
+                      std::to_string(result) + ")");
+            return false;
+        }
+        ma_pcm_rb_reset(&read_ahead);
+        decoded_since_rewind = 0;
+        end_of_stream = false;
+    }
+    
+    running = true;
+    decode_thread = std::thread([this]() { decodeLoop(); });
+    
+    // Prime: the first microframes should come from a full read-ahead, not a cold decoder
+    ma_uint32 primeFrames = ma_pcm_rb_get_subbuffer_size(&read_ahead) / 2;
+    std::chrono::steady_clock::time_point deadline = 
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(PRIME_TIMEOUT_MILLIS);
+    while (ma_pcm_rb_available_read(&read_ahead) < primeFrames && !end_of_stream.load() && 
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    LOG_INFO("📀 File source started with " + std::to_string(ma_pcm_rb_available_read(&read_ahead)) + 
+             " frames buffered");
+    return true;
+}
+
+void audio_file_source::stop() {
+    if (!running.load()) return;
+    
+    running = false;
+    if (decode_thread.joinable()) {
+        decode_thread.join();
+    }
+}
+
+void audio_file_source::decodeLoop() {
+    // Sleep for about a quarter of a chunk when there is no room to decode into
+    const std::chrono::microseconds idleSleep(
+        std::max<uint64_t>(1000, static_cast<uint64_t>(config.decodeChunkFrames) * 250000 / config.sampleRate));
+    
+    while (running.load()) {
+        if (end_of_stream.load() || !decodeChunk()) {
+            std::this_thread::sleep_for(idleSleep);
+        }
+    }
+}
+
+bool audio_file_source::decodeChunk() {
+    // Whole chunks only: many tiny decoder calls cost more than they buy
+    ma_uint32 frames = config.decodeChunkFrames;
+    if (ma_pcm_rb_available_write(&read_ahead) < frames) {
+        return false;
+    }
+    
+    void* pBuffer = nullptr;
+    if (ma_pcm_rb_acquire_write(&read_ahead, &frames, &pBuffer) != MA_SUCCESS || frames == 0) {
+        return false;
+    }
+    
+    int64_t decodeStartNs = audio_steady_time_ns();
+    ma_uint64 framesRead = 0;
+    ma_result result = ma_decoder_read_pcm_frames(&decoder, pBuffer, frames, &framesRead);
+    uint64_t decodeNs = static_cast<uint64_t>(audio_steady_time_ns() - decodeStartNs);
+    if (decodeNs > max_decode_ns.load(std::memory_order_relaxed)) {
+        max_decode_ns.store(decodeNs, std::memory_order_relaxed);
+    }
+    
+    ma_pcm_rb_commit_write(&read_ahead, static_cast<ma_uint32>(framesRead));
+    decoded_frames.fetch_add(framesRead, std::memory_order_relaxed);
+    decoded_since_rewind += framesRead;
+    
+    if (framesRead < frames) {
+        if (result != MA_SUCCESS && result != MA_AT_END) {
+            LOG_WARN("File source decoder error " + std::to_string(result) + " in " + name);
+        }
+        
+        // An empty pass after a rewind means there is nothing to loop
+        if (config.loop && decoded_since_rewind > 0 && ma_decoder_seek_to_pcm_frame(&decoder, 0) == MA_SUCCESS) {
+            decoded_since_rewind = 0;
+            loop_count.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            end_of_stream = true;
+            LOG_INFO("📀 File source reached the end of " + name);
+        }
+    }
+    return framesRead > 0;
+}
+
+void audio_file_source::fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) {
+    const size_t bytesPerFrame = config.channels * sizeof(float);
+    const size_t framesPerSlot = std::min(payloadBytes, slotStride) / bytesPerFrame;
+    const size_t filledBytes = framesPerSlot * bytesPerFrame;
+    const bool finished = end_of_stream.load(std::memory_order_relaxed);
+    
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        uint8_t* slot = slots + frame * slotStride;
+        
+        // At most two pieces per slot: the read-ahead can wrap mid-slot
+        size_t copied = 0;
+        while (copied < framesPerSlot) {
+            ma_uint32 frames = static_cast<ma_uint32>(framesPerSlot - copied);
+            void* pBuffer = nullptr;
+            if (ma_pcm_rb_acquire_read(&read_ahead, &frames, &pBuffer) != MA_SUCCESS || frames == 0) {
+                break;
+            }
+            std::memcpy(slot + copied * bytesPerFrame, pBuffer, frames * bytesPerFrame);
+            ma_pcm_rb_commit_read(&read_ahead, frames);
+            copied += frames;
+        }
+        
+        // Out of decoded audio: pad with silence rather than wait for the decoder
+        if (copied < framesPerSlot) {
+            std::memset(slot + copied * bytesPerFrame, 0, filledBytes - copied * bytesPerFrame);
+            if (!finished) {
+                starved_microframes.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        std::memset(slot + filledBytes, 0, slotStride - filledBytes);
+    }
+}
+
+const char* audio_file_source::getName() const {
+    return name.c_str();
+}
+
+uint64_t audio_file_source::getStarvedMicroframes() const {
+    return starved_microframes.load();
+}
+
+uint64_t audio_file_source::getDecodedFrames() const {
+    return decoded_frames.load();
+}
+
+uint64_t audio_file_source::getLoopCount() const {
+    return loop_count.load();
+}
+
+uint64_t audio_file_source::getMaxDecodeNs() const {
+    return max_decode_ns.load();
+}
+
+size_t audio_file_source::getBufferedFrames() {
+    return read_ahead_ready ? ma_pcm_rb_available_read(&read_ahead) : 0;
+}
+
+bool audio_file_source::isEndOfStream() const {
+    return end_of_stream.load();
+}
+
+} // namespace kcobain
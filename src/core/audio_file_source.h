@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include "iaudio_source.h"
+#include "../../external/miniaudio.h"
+
+namespace kcobain {
+
+/**
+ * @brief File source configuration
+ * The decoder converts whatever the file holds to 32-bit float at this
+ * rate and channel count, which must match the microframe payload.
+ */
+struct audio_file_source_config {
+    std::string path;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t readAheadMillis;       // Decoded audio kept ahead of the packer
+    uint32_t decodeChunkFrames;     // Sample frames per decoder call
+    bool loop;                      // Restart at the end of the file instead of going silent
+    
+    audio_file_source_config()
+        : sampleRate(96000), channels(2), readAheadMillis(500), decodeChunkFrames(4096), loop(true) {}
+};
+
+/**
+ * @brief Decoded audio file as a producer source
+ * A decode thread runs ma_decoder and keeps a read-ahead ma_pcm_rb topped
+ * up; the producer thread only copies out of that buffer. Decoder stalls
+ * (FLAC seeks, disk hiccups, the loop-back seek) are absorbed by the
+ * read-ahead and never reach the microframe cadence; if the buffer does run
+ * dry the slot is padded with silence and counted as starved.
+ */
+class audio_file_source : public iaudio_source {
+private:
+    audio_file_source_config config;
+    std::string name;
+    ma_decoder decoder;
+    ma_pcm_rb read_ahead;
+    bool decoder_ready;
+    bool read_ahead_ready;
+    std::thread decode_thread;
+    std::atomic<bool> running;
+    std::atomic<bool> end_of_stream;
+    std::atomic<uint64_t> starved_microframes;
+    std::atomic<uint64_t> decoded_frames;
+    std::atomic<uint64_t> loop_count;
+    std::atomic<uint64_t> max_decode_ns;     // Longest single decoder call
+    uint64_t decoded_since_rewind;           // Decode thread only
+
+    void decodeLoop();
+    bool decodeChunk();
+
+public:
+    audio_file_source();
+    ~audio_file_source();
+    
+    bool initialize(const audio_file_source_config& sourceConfig);
+    void uninitialize();
+    bool isInitialized() const;
+    
+    // Starts the decode thread and waits (bounded) for the read-ahead to fill; after the end of
+    // the file was reached the decoder is rewound and playback starts over from frame 0
+    bool start() override;
+    void stop() override;
+    void fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) override;
+    const char* getName() const override;
+    uint64_t getStarvedMicroframes() const override;
+    
+    uint64_t getDecodedFrames() const;
+    uint64_t getLoopCount() const;
+    uint64_t getMaxDecodeNs() const;
+    size_t getBufferedFrames();             // Sample frames waiting in the read-ahead
+    bool isEndOfStream() const;
+};
+
+} // namespace kcobain
@@ -0,0 +1,312 @@
+#include "audio_frame_ring.h"
+#include "../../include/kcobain/logger.h"
+#include <new>
+#include <thread>
+
+namespace kcobain {
+
+audio_frame_ring::audio_frame_ring()
+    : buffer(nullptr), frame_size(0), frame_count(0), indices(nullptr), mirrored(false), owns_indices(false), meta(nullptr),
+      notifier(nullptr) {
+}
+
+audio_frame_ring::~audio_frame_ring() {
+    uninitialize();
+}
+
+bool audio_frame_ring::initialize(void* pBuffer, size_t frameSize, size_t frameCount, bool mirroredBuffer,
+                                  audio_frame_ring_indices* pSharedIndices, audio_frame_meta* pMeta) {
+    if (!pBuffer || frameSize == 0 || frameCount == 0) {
+        LOG_ERROR("Cannot initialize frame ring - invalid buffer or geometry");
+        return false;
+    }
+
+    uninitialize();
+
+    if (pSharedIndices) {
+        // Shared indices are constructed and owned by whoever created the segment
+        indices = pSharedIndices;
+        owns_indices = false;
+    } else {
+        // Positions live in their own aligned block so the two cache lines never
+        // share a line with the controller or the slot storage
+        void* pIndices = ma_aligned_malloc(sizeof(audio_frame_ring_indices), KCOBAIN_CACHE_LINE_SIZE, NULL);
+        if (!pIndices) {
+            LOG_ERROR("Failed to allocate frame ring indices");
+            return false;
+        }
+        indices = new (pIndices) audio_frame_ring_indices();
+        owns_indices = true;
+    }
+
+    buffer = static_cast<uint8_t*>(pBuffer);
+    frame_size = frameSize;
+    frame_count = frameCount;
+    mirrored = mirroredBuffer;
+    meta = pMeta;
+    return true;
+}
+
+void audio_frame_ring::uninitialize() {
+    if (indices && owns_indices) {
+        indices->~audio_frame_ring_indices();
+        ma_aligned_free(indices, NULL);
+    }
+    indices = nullptr;
+    owns_indices = false;
+    buffer = nullptr;
+    frame_size = 0;
+    frame_count = 0;
+    mirrored = false;
+    meta = nullptr;
+}
+
+void audio_frame_ring::reset() {
+    if (!indices) return;
+    indices->write_pos.store(0, std::memory_order_relaxed);
+    indices->read_pos.store(0, std::memory_order_relaxed);
+    indices->cached_read_pos = 0;
+    indices->cached_write_pos = 0;
+    indices->writer_waiting.store(0, std::memory_order_relaxed);
+}
+
+ma_result audio_frame_ring::acquireWrite(size_t* pSizeInBytes, void** ppBuffer) {
+    if (!indices || !pSizeInBytes || !ppBuffer) {
+        return MA_INVALID_ARGS;
+    }
+
+    size_t frames = *pSizeInBytes / frame_size;
+    if (frames == 0) {
+        *pSizeInBytes = 0;
+        return MA_INVALID_ARGS;
+    }
+
+    // A full ring reports success with zero bytes, as ma_rb does
+    ma_result result = acquireWriteFrames(&frames, ppBuffer);
+    *pSizeInBytes = frames * frame_size;
+    return result;
+}
+
+ma_result audio_frame_ring::commitWrite(size_t sizeInBytes) {
+    if (!indices || sizeInBytes % frame_size != 0) {
+        return MA_INVALID_ARGS;
+    }
+    return commitWriteFrames(sizeInBytes / frame_size);
+}
+
+ma_result audio_frame_ring::acquireWriteFrames(size_t* pFrameCount, void** ppBuffer) {
+    if (!indices || !pFrameCount || !ppBuffer) {
+        return MA_INVALID_ARGS;
+    }
+
+    size_t framesWanted = *pFrameCount;
+    uint64_t writePos = indices->write_pos.load(std::memory_order_relaxed);
+    uint64_t framesFree = frame_count - (writePos - indices->cached_read_pos);
+    if (framesFree < framesWanted) {
+        // Only touch the consumer's line when the cached view looks short
+        indices->cached_read_pos = indices->read_pos.load(std::memory_order_acquire);
+        framesFree = frame_count - (writePos - indices->cached_read_pos);
+    }
+
+    size_t slot = static_cast<size_t>(writePos % frame_count);
+    size_t framesToEnd = mirrored ? frame_count : frame_count - slot;
+    size_t frames = framesWanted;
+    if (frames > framesFree) frames = static_cast<size_t>(framesFree);
+    if (frames > framesToEnd) frames = framesToEnd;
+
+    *pFrameCount = frames;
+    *ppBuffer = buffer + slot * frame_size;
+    return MA_SUCCESS;
+}
+
+ma_result audio_frame_ring::commitWriteFrames(size_t frameCount) {
+    if (!indices) {
+        return MA_INVALID_ARGS;
+    }
+
+    uint64_t writePos = indices->write_pos.load(std::memory_order_relaxed);
+    if (writePos + frameCount - indices->cached_read_pos > frame_count) {
+        return MA_INVALID_ARGS;
+    }
+
+    indices->write_pos.store(writePos + frameCount, std::memory_order_release);
+
+    if (notifier) {
+        // Pairs with the seq_cst arm in the notifier, as for the futex below
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t readPos = indices->read_pos.load(std::memory_order_relaxed);
+        notifier->onFramesReady(static_cast<size_t>(writePos + frameCount - readPos));
+    }
+    return MA_SUCCESS;
+}
+
+size_t audio_frame_ring::refreshWritableFrames() {
+    indices->cached_read_pos = indices->read_pos.load(std::memory_order_seq_cst);
+    uint64_t writePos = indices->write_pos.load(std::memory_order_relaxed);
+    return static_cast<size_t>(frame_count - (writePos - indices->cached_read_pos));
+}
+
+bool audio_frame_ring::waitForWritable(size_t frames, const audio_wait_config& waitConfig, int64_t* pWakeLatencyNs) {
+    if (pWakeLatencyNs) *pWakeLatencyNs = -1;
+    if (!indices) return false;
+    if (frames == 0) frames = 1;
+    if (frames > frame_count) frames = frame_count;
+
+    if (waitConfig.mode == audio_wait_mode::timed_sleep) {
+        std::this_thread::sleep_for(std::chrono::microseconds(waitConfig.sleepMicros));
+        return refreshWritableFrames() >= frames;
+    }
+
+    // Both remaining modes spin briefly first; the consumer frees a slot every 125μs
+    for (uint32_t i = 0; i < waitConfig.spinCount; ++i) {
+        if (refreshWritableFrames() >= frames) return true;
+        audio_cpu_relax();
+    }
+
+    if (waitConfig.mode == audio_wait_mode::spin_yield) {
+        std::this_thread::yield();
+        return refreshWritableFrames() >= frames;
+    }
+
+    // Futex park: announce the wait, re-check, then sleep until the consumer bumps the epoch
+    uint32_t epoch = indices->space_epoch.load(std::memory_order_acquire);
+    indices->writer_waiting.store(static_cast<uint32_t>(frames), std::memory_order_seq_cst);
+    if (refreshWritableFrames() >= frames) {
+        indices->writer_waiting.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    audio_futex_wait(&indices->space_epoch, epoch, waitConfig.timeoutMicros);
+    indices->writer_waiting.store(0, std::memory_order_relaxed);
+
+    if (pWakeLatencyNs && indices->space_epoch.load(std::memory_order_acquire) != epoch) {
+        *pWakeLatencyNs = audio_steady_time_ns() - indices->wake_time_ns.load(std::memory_order_relaxed);
+    }
+    return refreshWritableFrames() >= frames;
+}
+
+ma_result audio_frame_ring::acquireRead(size_t* pSizeInBytes, void** ppBuffer) {
+    if (!indices || !pSizeInBytes || !ppBuffer) {
+        return MA_INVALID_ARGS;
+    }
+
+    size_t frames = *pSizeInBytes / frame_size;
+    if (frames == 0) {
+        *pSizeInBytes = 0;
+        return MA_INVALID_ARGS;
+    }
+
+    // An empty ring reports success with zero bytes, as ma_rb does
+    ma_result result = acquireReadFrames(&frames, ppBuffer);
+    *pSizeInBytes = frames * frame_size;
+    return result;
+}
+
+ma_result audio_frame_ring::commitRead(size_t sizeInBytes) {
+    if (!indices || sizeInBytes % frame_size != 0) {
+        return MA_INVALID_ARGS;
+    }
+    return commitReadFrames(sizeInBytes / frame_size);
+}
+
+ma_result audio_frame_ring::acquireReadFrames(size_t* pFrameCount, void** ppBuffer) {
+    if (!indices || !pFrameCount || !ppBuffer) {
+        return MA_INVALID_ARGS;
+    }
+
+    size_t framesWanted = *pFrameCount;
+    uint64_t readPos = indices->read_pos.load(std::memory_order_relaxed);
+    uint64_t framesReady = indices->cached_write_pos - readPos;
+    if (framesReady < framesWanted) {
+        // Only touch the producer's line when the cached view looks short
+        indices->cached_write_pos = indices->write_pos.load(std::memory_order_acquire);
+        framesReady = indices->cached_write_pos - readPos;
+    }
+
+    size_t slot = static_cast<size_t>(readPos % frame_count);
+    size_t framesToEnd = mirrored ? frame_count : frame_count - slot;
+    size_t frames = framesWanted;
+    if (frames > framesReady) frames = static_cast<size_t>(framesReady);
+    if (frames > framesToEnd) frames = framesToEnd;
+
+    *pFrameCount = frames;
+    *ppBuffer = buffer + slot * frame_size;
+    return MA_SUCCESS;
+}
+
+ma_result audio_frame_ring::commitReadFrames(size_t frameCount) {
+    if (!indices) {
+        return MA_INVALID_ARGS;
+    }
+
+    uint64_t readPos = indices->read_pos.load(std::memory_order_relaxed);
+    if (readPos + frameCount > indices->cached_write_pos) {
+        return MA_INVALID_ARGS;
+    }
+
+    uint64_t newReadPos = readPos + frameCount;
+    indices->read_pos.store(newReadPos, std::memory_order_release);
+
+    // Pairs with the producer's seq_cst announce/re-check in waitForWritable;
+    // wake it only once the space it asked for is actually there
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (notifier) {
+        uint64_t writePos = indices->write_pos.load(std::memory_order_relaxed);
+        notifier->onFramesFree(static_cast<size_t>(frame_count - (writePos - newReadPos)));
+    }
+    uint32_t framesNeeded = indices->writer_waiting.load(std::memory_order_relaxed);
+    if (framesNeeded != 0) {
+        uint64_t writePos = indices->write_pos.load(std::memory_order_relaxed);
+        if (frame_count - (writePos - newReadPos) >= framesNeeded) {
+            indices->writer_waiting.store(0, std::memory_order_relaxed);
+            indices->wake_time_ns.store(audio_steady_time_ns(), std::memory_order_relaxed);
+            indices->space_epoch.fetch_add(1, std::memory_order_release);
+            audio_futex_wake(&indices->space_epoch);
+        }
+    }
+    return MA_SUCCESS;
+}
+
+size_t audio_frame_ring::availableRead() const {
+    if (!indices) return 0;
+    uint64_t readPos = indices->read_pos.load(std::memory_order_acquire);
+    uint64_t writePos = indices->write_pos.load(std::memory_order_acquire);
+    uint64_t frames = writePos - readPos;
+    // Both sides may move between the two loads; never report more than capacity
+    if (frames > frame_count) frames = frame_count;
+    return static_cast<size_t>(frames) * frame_size;
+}
+
+size_t audio_frame_ring::availableWrite() const {
+    if (!indices) return 0;
+    return frame_count * frame_size - availableRead();
+}
+
+size_t audio_frame_ring::getFrameSize() const {
+    return frame_size;
+}
+
+size_t audio_frame_ring::getFrameCount() const {
+    return frame_count;
+}
+
+bool audio_frame_ring::isMirrored() const {
+    return mirrored;
+}
+
+void audio_frame_ring::setNotifier(audio_ring_notifier* pNotifier) {
+    notifier = pNotifier;
+}
+
+bool audio_frame_ring::hasFrameMeta() const {
+    return meta != nullptr;
+}
+
+audio_frame_meta* audio_frame_ring::getFrameMeta(const void* pSlot) const {
+    if (!meta) return nullptr;
+    // Mirrored pointers may sit in the upper copy; the modulo folds them back
+    size_t slot = static_cast<size_t>(static_cast<const uint8_t*>(pSlot) - buffer) / frame_size;
+    return &meta[slot % frame_count];
+}
+
+} // namespace kcobain
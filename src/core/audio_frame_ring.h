@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "../../external/miniaudio.h"
+#include "audio_wait_strategy.h"
+#include "audio_ring_notifier.h"
+
+// Cache line size used to keep producer and consumer state apart
+#ifndef KCOBAIN_CACHE_LINE_SIZE
+    #define KCOBAIN_CACHE_LINE_SIZE 64
+#endif
+
+namespace kcobain {
+
+/**
+ * @brief Ring indices shared between producer and consumer
+ * Each side owns one cache line: its own position plus a cached copy of the
+ * opposite position, so the shared line is only pulled across cores when
+ * the cached view says the ring is full (producer) or empty (consumer).
+ */
+struct audio_frame_ring_indices {
+    // Producer cache line
+    alignas(KCOBAIN_CACHE_LINE_SIZE) std::atomic<uint64_t> write_pos;
+    uint64_t cached_read_pos;
+
+    // Consumer cache line
+    alignas(KCOBAIN_CACHE_LINE_SIZE) std::atomic<uint64_t> read_pos;
+    uint64_t cached_write_pos;
+
+    // Wait line: only written when the producer parks on a full ring
+    alignas(KCOBAIN_CACHE_LINE_SIZE) std::atomic<uint32_t> space_epoch;   // Futex word, bumped on wake
+    std::atomic<uint32_t> writer_waiting;                                 // Free slots the parked producer needs (0 = not parked)
+    std::atomic<int64_t> wake_time_ns;                                    // When the consumer issued the wake
+
+    audio_frame_ring_indices() 
+        : write_pos(0), cached_read_pos(0), read_pos(0), cached_write_pos(0),
+          space_epoch(0), writer_waiting(0), wake_time_ns(0) {}
+};
+
+/**
+ * @brief Per-slot metadata kept beside the payload
+ * Written by the producer before the commit that publishes the slot, so
+ * the ring's release/acquire on the positions also orders the metadata.
+ */
+struct audio_frame_meta {
+    uint64_t sequence;        // Monotonic per stream, starts at 0
+    int64_t timestamp_ns;     // Producer steady clock when the slot was committed
+    uint32_t payload_bytes;   // Valid bytes at the start of the slot (packets vary at fractional rates)
+};
+
+/**
+ * @brief Single-producer/single-consumer microframe ring
+ * Slot-based replacement for ma_rb. Capacity is counted in fixed-size
+ * microframes; acquire/commit keep the ma_rb shape (sizes in bytes) but
+ * always hand out whole microframes. Over mirrored memory an acquire is
+ * never clipped at the end of the buffer, so any batch is one pointer.
+ * The indices may be supplied by the caller (e.g. a shared segment), in
+ * which case both processes see the same positions and futex word.
+ */
+class audio_frame_ring {
+private:
+    uint8_t* buffer;                      // Slot storage (owned by the controller)
+    size_t frame_size;                    // Bytes per slot
+    size_t frame_count;                   // Number of slots
+    audio_frame_ring_indices* indices;    // Cache-line aligned positions
+    bool mirrored;                        // Slot storage is mapped twice back to back
+    bool owns_indices;                    // False when the indices live in shared memory
+    audio_frame_meta* meta;               // Optional side channel, one entry per slot
+    audio_ring_notifier* notifier;        // Optional eventfd readiness (set before streaming)
+
+    size_t refreshWritableFrames();
+
+public:
+    audio_frame_ring();
+    ~audio_frame_ring();
+
+    bool initialize(void* pBuffer, size_t frameSize, size_t frameCount, bool mirroredBuffer = false,
+                    audio_frame_ring_indices* pSharedIndices = nullptr, audio_frame_meta* pMeta = nullptr);
+    void uninitialize();
+    void reset();
+
+    // Producer side
+    ma_result acquireWrite(size_t* pSizeInBytes, void** ppBuffer);
+    ma_result commitWrite(size_t sizeInBytes);
+    ma_result acquireWriteFrames(size_t* pFrameCount, void** ppBuffer);   // Up to *pFrameCount contiguous slots
+    ma_result commitWriteFrames(size_t frameCount);
+    bool waitForWritable(size_t frames, const audio_wait_config& waitConfig, int64_t* pWakeLatencyNs);
+
+    // Consumer side
+    ma_result acquireRead(size_t* pSizeInBytes, void** ppBuffer);
+    ma_result commitRead(size_t sizeInBytes);
+    ma_result acquireReadFrames(size_t* pFrameCount, void** ppBuffer);
+    ma_result commitReadFrames(size_t frameCount);
+
+    size_t availableRead() const;
+    size_t availableWrite() const;
+    size_t getFrameSize() const;
+    size_t getFrameCount() const;
+    bool isMirrored() const;
+    void setNotifier(audio_ring_notifier* pNotifier);
+    
+    // Metadata for the slot at pSlot (any pointer handed out by an acquire); null without a side channel
+    bool hasFrameMeta() const;
+    audio_frame_meta* getFrameMeta(const void* pSlot) const;
+};
+
+} // namespace kcobain
@@ -0,0 +1,308 @@
+#include "audio_mapped_source.h"
+#include "audio_ring_memory.h"
+#include "../../include/kcobain/logger.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_MMAP
+#endif
+
+namespace kcobain {
+
+namespace {
+
+const uint16_t WAVE_FORMAT_PCM = 1;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+uint16_t readLe16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readLe32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+audio_mapped_source::audio_mapped_source()
+    : mapping(nullptr), mapping_bytes(0), data(nullptr), data_bytes(0), bytes_per_frame(0), position(0), locked(false),
+      end_of_stream(false), loop_count(0), bytes_packed(0) {
+}
+
+audio_mapped_source::~audio_mapped_source() {
+    uninitialize();
+}
+
+bool audio_mapped_source::parseWav(const uint8_t* file, size_t fileBytes) {
+    if (fileBytes < 12 || std::memcmp(file, "RIFF", 4) != 0 || std::memcmp(file + 8, "WAVE", 4) != 0) {
+        LOG_ERROR(name + " is not a RIFF/WAVE file");
+        return false;
+    }
+    
+    // Walk the chunks; fmt must come before data
+    bool haveFormat = false;
+    size_t offset = 12;
+    while (offset + 8 <= fileBytes) {
+        const uint8_t* chunk = file + offset;
+        size_t chunkBytes = readLe32(chunk + 4);
+        size_t bodyOffset = offset + 8;
+        
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && chunkBytes >= 16 && bodyOffset + 16 <= fileBytes) {
+            uint16_t formatTag = readLe16(chunk + 8);
+            uint16_t channels = readLe16(chunk + 10);
+            uint32_t sampleRate = readLe32(chunk + 12);
+            uint16_t bitsPerSample = readLe16(chunk + 22);
+            uint16_t validBits = bitsPerSample;
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && chunkBytes >= 26 && bodyOffset + 26 <= fileBytes) {
+                formatTag = readLe16(chunk + 32);   // First two bytes of the sub-format GUID
+                if (readLe16(chunk + 26) != 0) validBits = readLe16(chunk + 26);
+            }
+            if ((formatTag != WAVE_FORMAT_PCM && formatTag != WAVE_FORMAT_IEEE_FLOAT) || channels == 0 || 
+                bitsPerSample % 8 != 0 || bitsPerSample == 0) {
+                LOG_ERROR(name + " is not uncompressed PCM (format tag " + std::to_string(formatTag) + ")");
+                return false;
+            }
+            
+            // Samples are packed verbatim, so any other format would reach the wire as garbage
+            if (sampleRate != config.sampleRate || channels != config.channels || 
+                bitsPerSample / 8 != config.bytesPerSample) {
+                LOG_ERROR(name + " is " + std::to_string(sampleRate) + " Hz, " + std::to_string(channels) + " ch, " + 
+                          std::to_string(bitsPerSample) + "-bit, expected " + std::to_string(config.sampleRate) +
+                          " Hz, " + std::to_string(config.channels) + " ch, " +
+                          std::to_string(config.bytesPerSample * 8) + "-bit");
+                return false;
+            }
+            audio_sample_encoding encoding = formatTag == WAVE_FORMAT_IEEE_FLOAT ? audio_sample_encoding::ieee_float
+                                                                                : audio_sample_encoding::pcm;
+            if (encoding != config.encoding) {
+                LOG_ERROR(name + " holds " + (encoding == audio_sample_encoding::ieee_float ? "float" : "integer") +
+                          " samples, expected " + (config.encoding == audio_sample_encoding::ieee_float ? "float" : "integer"));
+                return false;
+            }
+            wire_format.sampleRate = sampleRate;
+            wire_format.channels = channels;
+            wire_format.subslotBytes = static_cast<uint8_t>(bitsPerSample / 8);
+            wire_format.bitResolution = static_cast<uint8_t>(std::min(validBits, bitsPerSample));
+            wire_format.encoding = encoding;
+            bytes_per_frame = static_cast<size_t>(channels) * (bitsPerSample / 8);
+            haveFormat = true;
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                LOG_ERROR(name + " has a data chunk before its fmt chunk");
+                return false;
+            }
+            // Truncated files (or 0xFFFFFFFF streaming sizes) end at the end of the file
+            data = file + bodyOffset;
+            data_bytes = std::min(chunkBytes, fileBytes - bodyOffset);
+            return true;
+        }
+        
+        // Chunks are padded to even sizes
+        offset = bodyOffset + chunkBytes + (chunkBytes & 1);
+    }
+    
+    LOG_ERROR(name + " has no data chunk");
+    return false;
+}
+
+bool audio_mapped_source::initialize(const audio_mapped_source_config& sourceConfig) {
+#ifdef KCOBAIN_HAS_MMAP
+    uninitialize();
+    
+    if (sourceConfig.path.empty() || sourceConfig.channels == 0 || sourceConfig.bytesPerSample == 0) {
+        LOG_ERROR("Cannot initialize mapped source - invalid configuration");
+        return false;
+    }
+    config = sourceConfig;
+    size_t slash = config.path.find_last_of('/');
+    name = slash == std::string::npos ? config.path : config.path.substr(slash + 1);
+    
+    int fd = open(config.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open " + config.path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        LOG_ERROR(config.path + " is empty or unreadable");
+        close(fd);
+        return false;
+    }
+    
+    // The mapping outlives the descriptor
+    mapping_bytes = static_cast<size_t>(info.st_size);
+    void* p = mmap(NULL, mapping_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("Failed to map " + config.path);
+        mapping_bytes = 0;
+        return false;
+    }
+    mapping = p;
+    
+    const uint8_t* file = static_cast<const uint8_t*>(mapping);
+    if (config.rawPcm) {
+        data = file;
+        data_bytes = mapping_bytes;
+        bytes_per_frame = static_cast<size_t>(config.channels) * config.bytesPerSample;
+        wire_format.sampleRate = config.sampleRate;
+        wire_format.channels = config.channels;
+        wire_format.subslotBytes = static_cast<uint8_t>(config.bytesPerSample);
+        wire_format.bitResolution = static_cast<uint8_t>(config.bytesPerSample * 8);
+        wire_format.encoding = config.encoding;
+    } else if (!parseWav(file, mapping_bytes)) {
+        uninitialize();
+        return false;
+    }
+    
+    data_bytes -= data_bytes % bytes_per_frame;
+    if (data_bytes == 0) {
+        LOG_ERROR(name + " holds no complete sample frames");
+        uninitialize();
+        return false;
+    }
+    
+    // Front-to-back access: let the kernel read ahead aggressively
+    madvise(mapping, mapping_bytes, MADV_SEQUENTIAL);
+    
+    LOG_INFO("🗺️ Mapped source: " + name + ", " + std::to_string(data_bytes / bytes_per_frame) + " frames (" + 
+             std::to_string(data_bytes) + " bytes)");
+    return true;
+#else
+    (void)sourceConfig;
+    LOG_ERROR("Mapped sources are not supported on this platform");
+    return false;
+#endif
+}
+
+void audio_mapped_source::uninitialize() {
+#ifdef KCOBAIN_HAS_MMAP
+    if (mapping) {
+        if (locked) {
+            munlock(mapping, mapping_bytes);
+        }
+        munmap(mapping, mapping_bytes);
+    }
+#endif
+    mapping = nullptr;
+    mapping_bytes = 0;
+    data = nullptr;
+    data_bytes = 0;
+    bytes_per_frame = 0;
+    wire_format = audio_microframe_format();
+    position = 0;
+    locked = false;
+}
+
+bool audio_mapped_source::isInitialized() const {
+    return data != nullptr;
+}
+
+bool audio_mapped_source::start() {
+    if (!isInitialized()) {
+        LOG_ERROR("Cannot start mapped source - not initialized");
+        return false;
+    }
+    
+    position = 0;
+    end_of_stream = false;
+    
+#ifdef KCOBAIN_HAS_MMAP
+    // Start the first reads now rather than on the first microframe
+    madvise(mapping, mapping_bytes, MADV_WILLNEED);
+    
+    if (config.lockPages && !locked) {
+        if (mlock(mapping, mapping_bytes) == 0) {
+            locked = true;
+        } else {
+            LOG_WARN("mlock failed for " + name + " (check RLIMIT_MEMLOCK), streaming may fault");
+        }
+    }
+#endif
+    
+    if (config.prefault) {
+        audio_page_faults before = audio_ring_memory::getThreadPageFaults();
+        volatile const uint8_t* bytes = static_cast<volatile const uint8_t*>(mapping);
+        uint8_t sink = 0;
+        for (size_t offset = 0; offset < mapping_bytes; offset += audio_ring_memory::getPageSize()) {
+            sink ^= bytes[offset];
+        }
+        (void)sink;
+        audio_page_faults after = audio_ring_memory::getThreadPageFaults();
+        LOG_INFO("🗺️ Prefaulted " + name + ": " + std::to_string(after.minor - before.minor) + " minor, " + 
+                 std::to_string(after.major - before.major) + " major faults");
+    }
+    return true;
+}
+
+void audio_mapped_source::stop() {
+}
+
+void audio_mapped_source::fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) {
+    const size_t filledBytes = std::min(payloadBytes, slotStride) / bytes_per_frame * bytes_per_frame;
+    size_t packed = 0;
+    
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        uint8_t* slot = slots + frame * slotStride;
+        
+        // At most two pieces per slot when the payload straddles the loop point
+        size_t copied = 0;
+        while (copied < filledBytes && position < data_bytes) {
+            size_t chunk = std::min(filledBytes - copied, data_bytes - position);
+            std::memcpy(slot + copied, data + position, chunk);
+            copied += chunk;
+            position += chunk;
+            if (position == data_bytes && config.loop) {
+                position = 0;
+                loop_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        packed += copied;
+        
+        // Past the end of a non-looping file: silence
+        if (copied < filledBytes) {
+            std::memset(slot + copied, 0, filledBytes - copied);
+            end_of_stream.store(true, std::memory_order_relaxed);
+        }
+        std::memset(slot + filledBytes, 0, slotStride - filledBytes);
+    }
+    bytes_packed.fetch_add(packed, std::memory_order_relaxed);
+}
+
+const char* audio_mapped_source::getName() const {
+    return name.c_str();
+}
+
+bool audio_mapped_source::getWireFormat(audio_microframe_format* pFormat) const {
+    if (pFormat) *pFormat = wire_format;
+    return true;
+}
+
+size_t audio_mapped_source::getDataBytes() const {
+    return data_bytes;
+}
+
+uint64_t audio_mapped_source::getLoopCount() const {
+    return loop_count.load();
+}
+
+uint64_t audio_mapped_source::getBytesPacked() const {
+    return bytes_packed.load();
+}
+
+bool audio_mapped_source::isEndOfStream() const {
+    return end_of_stream.load();
+}
+
+bool audio_mapped_source::isLocked() const {
+    return locked;
+}
+
+} // namespace kcobain
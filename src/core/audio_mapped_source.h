@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include "iaudio_source.h"
+
+namespace kcobain {
+
+/**
+ * @brief Mapped PCM source configuration
+ * WAV files describe their own format and must match the expected one
+ * (initialize fails otherwise); raw files are taken to be in it.
+ */
+struct audio_mapped_source_config {
+    std::string path;
+    bool rawPcm;                    // Headerless file: every byte is sample data
+    uint32_t sampleRate;            // Expected format (must match the microframe payload)
+    uint16_t channels;
+    uint16_t bytesPerSample;
+    audio_sample_encoding encoding; // Integer PCM or 32-bit float
+    bool loop;                      // Wrap to the first frame at the end of the data
+    bool prefault;                  // Touch every page in start() so streaming never faults
+    bool lockPages;                 // mlock the mapping
+    
+    audio_mapped_source_config()
+        : rawPcm(false), sampleRate(96000), channels(2), bytesPerSample(4), encoding(audio_sample_encoding::ieee_float),
+          loop(true), prefault(false),
+          lockPages(false) {}
+};
+
+/**
+ * @brief Memory-mapped PCM source
+ * Maps an uncompressed WAV or raw PCM file read-only and packs microframes
+ * straight from the mapping: no decoder, no intermediate buffer, one copy
+ * into the slot. Samples are copied verbatim, so a run is bit-exact with
+ * the file; getWireFormat() reports the file's format and the packer only
+ * takes it into a stream of that format. The mapping is advised sequential so the kernel reads ahead;
+ * for stress runs, prefault/lockPages keep page faults out of the loop.
+ */
+class audio_mapped_source : public iaudio_source {
+private:
+    audio_mapped_source_config config;
+    std::string name;
+    void* mapping;
+    size_t mapping_bytes;
+    const uint8_t* data;            // First sample frame inside the mapping
+    size_t data_bytes;              // Whole sample frames only
+    size_t bytes_per_frame;         // One sample frame, all channels
+    audio_microframe_format wire_format;    // What the bytes are, from the WAV header or the config
+    size_t position;                // Byte offset of the next frame (producer thread only)
+    bool locked;
+    std::atomic<bool> end_of_stream;
+    std::atomic<uint64_t> loop_count;
+    std::atomic<uint64_t> bytes_packed;
+
+    bool parseWav(const uint8_t* file, size_t fileBytes);
+
+public:
+    audio_mapped_source();
+    ~audio_mapped_source();
+    
+    bool initialize(const audio_mapped_source_config& sourceConfig);
+    void uninitialize();
+    bool isInitialized() const;
+    
+    bool start() override;
+    void stop() override;
+    void fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) override;
+    const char* getName() const override;
+    bool getWireFormat(audio_microframe_format* pFormat) const override;
+    
+    size_t getDataBytes() const;
+    uint64_t getLoopCount() const;
+    uint64_t getBytesPacked() const;
+    bool isEndOfStream() const;
+    bool isLocked() const;
+};
+
+} // namespace kcobain
@@ -0,0 +1,119 @@
+#include "audio_microframe_packer.h"
+#include "../../include/kcobain/logger.h"
+#include <algorithm>
+#include <cstring>
+
+namespace kcobain {
+
+audio_microframe_packer::audio_microframe_packer()
+    : max_batch(0), slot_frames(0) {
+}
+
+bool audio_microframe_packer::initialize(const audio_microframe_format& microframeFormat, size_t maxBatchFrames) {
+    if (!microframeFormat.isValid() || maxBatchFrames == 0) {
+        LOG_ERROR("Invalid microframe packer setup: " + microframeFormat.describe() + ", batch " + 
+                  std::to_string(maxBatchFrames));
+        return false;
+    }
+    
+    format = microframeFormat;
+    packets.initialize(format);
+    max_batch = maxBatchFrames;
+    slot_frames = format.getFramesPerMicroframe();
+    packet_frames.assign(max_batch, 0);
+    scratch.clear();
+    if (!format.isFloat() || packets.isFractional()) {
+        scratch.assign(max_batch * format.getSamplesPerMicroframe(), 0.0f);
+    }
+    return true;
+}
+
+void audio_microframe_packer::pack(iaudio_source* source, uint8_t* slots, size_t frameCount, size_t slotStride,
+                                   size_t payloadBytes) {
+    const size_t channels = format.channels;
+    const size_t bytesPerFrame = format.getBytesPerFrame();
+    frameCount = std::min(frameCount, max_batch);
+    
+    // Whole sample frames only, in case the slot cannot hold the full packet
+    slot_frames = std::min(payloadBytes, slotStride) / bytesPerFrame;
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        packet_frames[frame] = static_cast<uint32_t>(packets.next());
+    }
+    
+    // Wire-format bytes go in as they are, one call per packet when their sizes vary
+    audio_microframe_format sourceFormat;
+    if (source->getWireFormat(&sourceFormat)) {
+        if (!sourceFormat.hasSameSamples(format)) {
+            // accepts() turns such a source away; never reinterpret its bytes
+            std::memset(slots, 0, frameCount * slotStride);
+            return;
+        }
+        if (!packets.isFractional()) {
+            source->fillMicroframes(slots, frameCount, slotStride, slot_frames * bytesPerFrame);
+        } else {
+            for (size_t frame = 0; frame < frameCount; ++frame) {
+                const size_t frames = std::min(static_cast<size_t>(packet_frames[frame]), slot_frames);
+                source->fillMicroframes(slots + frame * slotStride, 1, slotStride, frames * bytesPerFrame);
+            }
+        }
+        return;
+    }
+    
+    if (format.isFloat() && !packets.isFractional()) {
+        source->fillMicroframes(slots, frameCount, slotStride, slot_frames * bytesPerFrame);
+        return;
+    }
+    
+    // The source renders the batch as contiguous float packets, one call per
+    // packet when their sizes vary so per-microframe source accounting still holds
+    if (!packets.isFractional()) {
+        const size_t floatBytes = format.getSamplesPerMicroframe() * sizeof(float);
+        source->fillMicroframes(reinterpret_cast<uint8_t*>(scratch.data()), frameCount, floatBytes, floatBytes);
+    } else {
+        size_t offset = 0;
+        for (size_t frame = 0; frame < frameCount; ++frame) {
+            const size_t floatBytes = packet_frames[frame] * channels * sizeof(float);
+            source->fillMicroframes(reinterpret_cast<uint8_t*>(scratch.data() + offset), 1, floatBytes, floatBytes);
+            offset += packet_frames[frame] * channels;
+        }
+    }
+    
+    size_t offset = 0;
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+        uint8_t* slot = slots + frame * slotStride;
+        const size_t frames = std::min(static_cast<size_t>(packet_frames[frame]), slot_frames);
+        const size_t bytes = frames * bytesPerFrame;
+        audio_convert_from_float(scratch.data() + offset, slot, frames * channels, format);
+        std::memset(slot + bytes, 0, slotStride - bytes);
+        offset += packet_frames[frame] * channels;
+    }
+}
+
+bool audio_microframe_packer::accepts(const iaudio_source* source) const {
+    audio_microframe_format sourceFormat;
+    if (!source || !source->getWireFormat(&sourceFormat) || sourceFormat.hasSameSamples(format)) {
+        return true;
+    }
+    LOG_ERROR(std::string(source->getName()) + " writes " + sourceFormat.describe() + " payloads, the stream is " +
+              format.describe());
+    return false;
+}
+
+uint32_t audio_microframe_packer::getPacketBytes(size_t frame) const {
+    if (frame >= max_batch) return 0;
+    return static_cast<uint32_t>(std::min(static_cast<size_t>(packet_frames[frame]), slot_frames) * format.getBytesPerFrame());
+}
+
+const audio_microframe_format& audio_microframe_packer::getFormat() const {
+    return format;
+}
+
+const audio_packet_scheduler& audio_microframe_packer::getScheduler() const {
+    return packets;
+}
+
+size_t audio_microframe_packer::getMaxBatchFrames() const {
+    return max_batch;
+}
+
+} // namespace kcobain
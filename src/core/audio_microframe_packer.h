@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "audio_sample_format.h"
+#include "audio_packet_scheduler.h"
+#include "iaudio_source.h"
+
+namespace kcobain {
+
+/**
+ * @brief Packs source audio into microframe slots
+ * Owns everything between an iaudio_source and the ring: the packet
+ * schedule, the float staging buffer and the wire-format conversion.
+ * Constant-size f32 packets are rendered straight into the slots; integer
+ * formats and variable-length packets are rendered into preallocated
+ * scratch and converted, so packing never touches the heap. Sources that
+ * write wire-format bytes (iaudio_source::getWireFormat) are copied
+ * verbatim when their format is the stream's; any other such source packs
+ * silence rather than misread bytes. Not thread safe.
+ */
+class audio_microframe_packer {
+private:
+    audio_microframe_format format;
+    audio_packet_scheduler packets;
+    std::vector<float> scratch;             // Float staging for one batch
+    std::vector<uint32_t> packet_frames;    // Scheduled sample frames per slot of the latest batch
+    size_t max_batch;
+    size_t slot_frames;                     // Sample frames that fit a slot in the latest batch
+
+public:
+    audio_microframe_packer();
+    
+    bool initialize(const audio_microframe_format& microframeFormat, size_t maxBatchFrames);
+    
+    // Fill frameCount (<= max batch) slots; the packet schedule advances once per slot.
+    // payloadBytes caps the packet, the rest of each slot is zeroed
+    void pack(iaudio_source* source, uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes);
+    
+    // Float sources always; wire-format sources only in exactly this format (logs why not)
+    bool accepts(const iaudio_source* source) const;
+    
+    // Valid bytes in slot `frame` of the latest batch (for the slot metadata)
+    uint32_t getPacketBytes(size_t frame) const;
+    
+    const audio_microframe_format& getFormat() const;
+    const audio_packet_scheduler& getScheduler() const;
+    size_t getMaxBatchFrames() const;
+};
+
+} // namespace kcobain
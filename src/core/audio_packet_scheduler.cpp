@@ -0,0 +1,62 @@
+#include "audio_packet_scheduler.h"
+#include "../../include/kcobain/logger.h"
+
+namespace kcobain {
+
+audio_packet_scheduler::audio_packet_scheduler()
+    : sample_rate(96000), microframe_rate(8000), remainder(0), total_frames(0), packet_count(0) {
+}
+
+bool audio_packet_scheduler::initialize(const audio_microframe_format& format) {
+    if (format.sampleRate == 0 || format.microframesPerSecond == 0) {
+        LOG_ERROR("Invalid packet schedule: " + std::to_string(format.sampleRate) + " Hz at " +
+                  std::to_string(format.microframesPerSecond) + " microframes/s");
+        return false;
+    }
+    sample_rate = format.sampleRate;
+    microframe_rate = format.microframesPerSecond;
+    reset();
+    return true;
+}
+
+void audio_packet_scheduler::reset() {
+    remainder = 0;
+    total_frames = 0;
+    packet_count = 0;
+}
+
+size_t audio_packet_scheduler::next() {
+    // remainder < microframe_rate, so the sum fits comfortably in 64 bits
+    uint64_t due = static_cast<uint64_t>(remainder) + sample_rate;
+    size_t frames = static_cast<size_t>(due / microframe_rate);
+    remainder = static_cast<uint32_t>(due % microframe_rate);
+    total_frames += frames;
+    ++packet_count;
+    return frames;
+}
+
+size_t audio_packet_scheduler::peek() const {
+    return static_cast<size_t>((static_cast<uint64_t>(remainder) + sample_rate) / microframe_rate);
+}
+
+size_t audio_packet_scheduler::getMinFrames() const {
+    return sample_rate / microframe_rate;
+}
+
+size_t audio_packet_scheduler::getMaxFrames() const {
+    return (sample_rate + microframe_rate - 1) / microframe_rate;
+}
+
+bool audio_packet_scheduler::isFractional() const {
+    return sample_rate % microframe_rate != 0;
+}
+
+uint64_t audio_packet_scheduler::getTotalFrames() const {
+    return total_frames;
+}
+
+uint64_t audio_packet_scheduler::getPacketCount() const {
+    return packet_count;
+}
+
+} // namespace kcobain
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "audio_sample_format.h"
+
+namespace kcobain {
+
+/**
+ * @brief Sample-accurate packet sizes for any sample rate
+ * A microframe carries sampleRate / microframesPerSecond sample frames,
+ * which is fractional for the 44.1 kHz family (5.5125 at 44.1 kHz high
+ * speed). The scheduler keeps the remainder as an exact integer, like a
+ * Bresenham line: each packet is the floor or the ceiling of the mean, and
+ * after N packets exactly N × sampleRate / microframesPerSecond frames have
+ * been scheduled, rounded down - no drift over any run length.
+ * Integer rates degenerate to a constant packet. Not thread safe.
+ */
+class audio_packet_scheduler {
+private:
+    uint32_t sample_rate;
+    uint32_t microframe_rate;
+    uint32_t remainder;             // Fractional frames carried, in 1/microframe_rate units
+    uint64_t total_frames;
+    uint64_t packet_count;
+
+public:
+    audio_packet_scheduler();
+    
+    bool initialize(const audio_microframe_format& format);
+    void reset();
+    
+    // Sample frames in the next packet; advances the schedule
+    size_t next();
+    // Sample frames in the next packet without advancing
+    size_t peek() const;
+    
+    size_t getMinFrames() const;    // Floor of the mean packet
+    size_t getMaxFrames() const;    // Ceiling of the mean packet
+    bool isFractional() const;      // Packet sizes alternate
+    uint64_t getTotalFrames() const;
+    uint64_t getPacketCount() const;
+};
+
+} // namespace kcobain
@@ -0,0 +1,85 @@
+#include "audio_precise_timer.h"
+#include "audio_wait_strategy.h"
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+    #include <sys/prctl.h>
+    #include <time.h>
+    #define KCOBAIN_HAS_CLOCK_NANOSLEEP
+#endif
+
+namespace kcobain {
+
+void audio_sleep_until_ns(int64_t deadlineNs) {
+#ifdef KCOBAIN_HAS_CLOCK_NANOSLEEP
+    struct timespec deadline;
+    deadline.tv_sec = static_cast<time_t>(deadlineNs / 1000000000);
+    deadline.tv_nsec = static_cast<long>(deadlineNs % 1000000000);
+    // Absolute, so a signal just restarts the same sleep without drifting
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+    }
+#else
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(deadlineNs)));
+#endif
+}
+
+audio_precise_timer::audio_precise_timer(const audio_timer_config& timerConfig)
+    : config(timerConfig), oversleeps(0) {
+}
+
+void audio_precise_timer::prepareThread() {
+#ifdef KCOBAIN_HAS_CLOCK_NANOSLEEP
+    // The default 50μs slack alone is 40% of a microframe
+    if (config.minimizeSlack) {
+        prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+    }
+#endif
+}
+
+int64_t audio_precise_timer::sleepUntil(int64_t deadlineNs) {
+    const int64_t marginNs = static_cast<int64_t>(config.spinMarginMicros) * 1000;
+    if (deadlineNs - audio_steady_time_ns() > marginNs) {
+        audio_sleep_until_ns(deadlineNs - marginNs);
+    }
+    int64_t nowNs = audio_steady_time_ns();
+    if (marginNs > 0 && nowNs > deadlineNs) {
+        oversleeps.fetch_add(1, std::memory_order_relaxed);
+    }
+    while (nowNs < deadlineNs) {
+        audio_cpu_relax();
+        nowNs = audio_steady_time_ns();
+    }
+
+    int64_t latenessNs = nowNs - deadlineNs;
+    lateness.record(static_cast<uint64_t>(latenessNs));
+    return latenessNs;
+}
+
+const audio_timer_config& audio_precise_timer::getConfig() const {
+    return config;
+}
+
+audio_latency_snapshot audio_precise_timer::getLatenessSnapshot() const {
+    audio_latency_snapshot snap;
+    lateness.snapshot(&snap);
+    return snap;
+}
+
+audio_latency_snapshot audio_precise_timer::takeLatenessInterval() {
+    audio_latency_snapshot snap;
+    lateness.takeInterval(&snap);
+    return snap;
+}
+
+uint64_t audio_precise_timer::getOversleepCount() const {
+    return oversleeps.load(std::memory_order_relaxed);
+}
+
+void audio_precise_timer::reset() {
+    lateness.reset();
+    oversleeps.store(0, std::memory_order_relaxed);
+}
+
+} // namespace kcobain
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "audio_rb_telemetry.h"
+
+namespace kcobain {
+
+/**
+ * @brief Hybrid sleep/spin timer configuration
+ */
+struct audio_timer_config {
+    uint32_t spinMarginMicros;  // Sleep until this close to the deadline, then spin (0 = sleep only)
+    bool minimizeSlack;         // Drop the thread's timer slack to 1ns (Linux) in prepareThread()
+
+    audio_timer_config() : spinMarginMicros(50), minimizeSlack(true) {}
+};
+
+/**
+ * @brief Absolute-deadline timer for microframe cadences
+ * Sleeps with clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) until
+ * spinMarginMicros before the deadline, then spins on a pause instruction.
+ * The kernel's oversleep (timer slack, wake-up latency) lands inside the
+ * margin instead of after the deadline. Deadlines are audio_steady_time_ns()
+ * values, which is CLOCK_MONOTONIC on Linux. Every wake-up's lateness is
+ * recorded; the timer is driven by one thread, statistics can be read from
+ * any.
+ */
+class audio_precise_timer {
+private:
+    audio_timer_config config;
+    audio_latency_histogram lateness;   // Wake-up time minus deadline
+    std::atomic<uint64_t> oversleeps;   // Sleeps that ended past the deadline (margin too small)
+
+public:
+    explicit audio_precise_timer(const audio_timer_config& timerConfig = audio_timer_config());
+
+    // Call once on the thread that will sleep
+    void prepareThread();
+    // Returns when the deadline has passed; returns the lateness in ns
+    int64_t sleepUntil(int64_t deadlineNs);
+
+    const audio_timer_config& getConfig() const;
+    audio_latency_snapshot getLatenessSnapshot() const;
+    audio_latency_snapshot takeLatenessInterval();   // Since the previous call; one caller only
+    uint64_t getOversleepCount() const;
+    void reset();
+};
+
+// Plain absolute sleep on the monotonic clock, no spin and no statistics
+void audio_sleep_until_ns(int64_t deadlineNs);
+
+} // namespace kcobain
@@ -0,0 +1,49 @@
+#include "audio_rate_controller.h"
+
+namespace kcobain {
+
+audio_rate_controller::audio_rate_controller() : integral(0.0), rate_hz(0.0) {
+    initialize(audio_pacing_config());
+}
+
+void audio_rate_controller::initialize(const audio_pacing_config& pacingConfig) {
+    config = pacingConfig;
+    reset();
+}
+
+void audio_rate_controller::reset() {
+    integral = 0.0;
+    rate_hz = config.nominalRateHz;
+}
+
+double audio_rate_controller::update(size_t fillFrames, double elapsedSeconds) {
+    double error = static_cast<double>(config.targetFillFrames) - static_cast<double>(fillFrames);
+    double candidateIntegral = integral + error * elapsedSeconds;
+    double output = config.nominalRateHz + config.kp * error + config.ki * candidateIntegral;
+    
+    double minRate = config.nominalRateHz * (1.0 - config.maxRateDeviation);
+    double maxRate = config.nominalRateHz * (1.0 + config.maxRateDeviation);
+    if (minRate < 0.0) minRate = 0.0;
+    
+    // Anti-windup: only integrate while the output is inside the clamp
+    if (output > maxRate) {
+        output = maxRate;
+    } else if (output < minRate) {
+        output = minRate;
+    } else {
+        integral = candidateIntegral;
+    }
+    
+    rate_hz = output;
+    return rate_hz;
+}
+
+double audio_rate_controller::getRateHz() const {
+    return rate_hz;
+}
+
+const audio_pacing_config& audio_rate_controller::getConfig() const {
+    return config;
+}
+
+} // namespace kcobain
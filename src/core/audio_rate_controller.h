@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kcobain {
+
+/**
+ * @brief Paced producer configuration
+ * A paced producer holds the ring at a fill setpoint instead of keeping it
+ * full, so queueing latency is targetFillFrames microframes rather than the
+ * whole ring. Gains are in microframes/s per microframe of error (kp) and
+ * per microframe·second of accumulated error (ki); the defaults give a
+ * critically damped loop that settles in about a quarter of a second.
+ */
+struct audio_pacing_config {
+    bool enabled;                   // false = free-running, fill the ring as fast as it drains
+    uint32_t targetFillFrames;      // Setpoint: microframes queued when the producer wakes
+    uint32_t tickMicros;            // Production period
+    double nominalRateHz;           // Consumer microframe rate (8000 for USB high speed)
+    double kp;                      // Proportional gain, 1/s
+    double ki;                      // Integral gain, 1/s²
+    double maxRateDeviation;        // Output clamp as a fraction of the nominal rate
+    
+    audio_pacing_config()
+        : enabled(false), targetFillFrames(16), tickMicros(1000), nominalRateHz(8000.0), kp(40.0), ki(400.0),
+          maxRateDeviation(0.5) {}
+};
+
+/**
+ * @brief Pacing figures for a producer
+ */
+struct audio_pacing_stats {
+    bool enabled;
+    uint32_t targetFill;            // Setpoint in microframes
+    uint32_t lastFill;              // Fill seen at the latest tick
+    uint32_t minFill;               // Lowest fill seen at a tick once settled
+    uint32_t maxFill;               // Highest fill seen at a tick once settled
+    double rateHz;                  // Current production rate
+    uint64_t ticks;
+    
+    audio_pacing_stats() : enabled(false), targetFill(0), lastFill(0), minFill(0), maxFill(0), rateHz(0.0), ticks(0) {}
+};
+
+/**
+ * @brief PI controller from ring fill to production rate
+ * Not thread safe: owned and updated by the producer thread only.
+ * The integral is frozen while the output is clamped so a long stall or
+ * start-up does not wind it up.
+ */
+class audio_rate_controller {
+private:
+    audio_pacing_config config;
+    double integral;                // Accumulated error, microframe·seconds
+    double rate_hz;
+    
+public:
+    audio_rate_controller();
+    
+    void initialize(const audio_pacing_config& pacingConfig);
+    void reset();
+    
+    // One control step: fill seen now, seconds since the previous step; returns the new rate
+    double update(size_t fillFrames, double elapsedSeconds);
+    
+    double getRateHz() const;
+    const audio_pacing_config& getConfig() const;
+};
+
+} // namespace kcobain
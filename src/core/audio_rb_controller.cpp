@@ -5,36 +5,348 @@
 namespace kcobain {
 
 audio_rb_controller::audio_rb_controller() 
-    : buffer_size_bytes(0), initialized(false) {
+    : claimed_lanes(0), write_generation(nullptr), read_generation(nullptr), pending_generation(nullptr), 
+      initialized(false) {
 }
 
 audio_rb_controller::~audio_rb_controller() {
-    if (initialized) {
-        ma_rb_uninit(&ring_buffer);
-    }
+    // A pending ring that was never picked up is still owned by generations;
+    // shared rings unmap their slots before the segment header goes away
+    generations.clear();
+    extra_lanes.clear();
+    shared_segment.reset();
+    notifier.reset();
 }
 
-bool audio_rb_controller::initialize(size_t bufferSizeBytes) {
+bool audio_rb_controller::initialize(size_t bufferSizeBytes, size_t frameSize) {
+    audio_rb_config rbConfig;
+    rbConfig.frameSize = frameSize;
+    return initialize(bufferSizeBytes, rbConfig);
+}
+
+bool audio_rb_controller::initialize(size_t bufferSizeBytes, const audio_rb_config& rbConfig) {
     if (initialized) {
         LOG_WARN("Ring buffer already initialized");
         return true;
     }
     
-    buffer_size_bytes = bufferSizeBytes;
-    ma_result result = ma_rb_init(bufferSizeBytes, NULL, NULL, &ring_buffer);
+    if (rbConfig.producerLanes == 0 || rbConfig.producerLanes > 64) {
+        LOG_ERROR("Invalid producer lane count: " + std::to_string(rbConfig.producerLanes) + " (1-64)");
+        return false;
+    }
+    if (rbConfig.producerLanes > 1 && !rbConfig.sharedName.empty()) {
+        LOG_ERROR("Fan-in lanes are not supported on shared ring buffers");
+        return false;
+    }
+    
+    config = rbConfig;
+    std::unique_ptr<ring_generation> generation = createGeneration(bufferSizeBytes);
+    if (!generation) {
+        shared_segment.reset();
+        return false;
+    }
+    
+    // Every extra producer gets its own ring of the same geometry
+    extra_lanes.clear();
+    for (size_t lane = 1; lane < config.producerLanes; ++lane) {
+        std::unique_ptr<ring_generation> laneGeneration = createGeneration(bufferSizeBytes);
+        if (!laneGeneration) {
+            extra_lanes.clear();
+            return false;
+        }
+        extra_lanes.push_back(std::move(laneGeneration));
+    }
+    if (config.producerLanes > 1) {
+        LOG_INFO("🔀 Fan-in mode: " + std::to_string(config.producerLanes) + " producer lanes");
+    }
+    
+    // Record what the memory layer actually delivered (mirroring may fall back)
+    config.backing = generation->memory.getBacking();
+    if (shared_segment) {
+        // The consumer process may attach from here on
+        shared_segment->markReady();
+        LOG_INFO("🔗 Ring shared as " + config.sharedName);
+    }
+    fill_telemetry.initialize(generation->ring.getFrameCount());
+    write_generation.store(generation.get());
+    read_generation.store(generation.get());
+    generations.push_back(std::move(generation));
+    initialized = true;
+    return true;
+}
+
+std::unique_ptr<audio_rb_controller::ring_generation> audio_rb_controller::createGeneration(size_t bufferSizeBytes) {
+    size_t frameSize = config.frameSize;
+    if (frameSize == 0 || bufferSizeBytes < frameSize) {
+        LOG_ERROR("Invalid ring buffer geometry: " + std::to_string(bufferSizeBytes) + 
+                  " bytes for " + std::to_string(frameSize) + " byte microframes");
+        return std::unique_ptr<ring_generation>();
+    }
+    
+    // The ring is sized in whole microframes
+    size_t frameCount = bufferSizeBytes / frameSize;
+    if (config.backing == audio_rb_backing::mirrored) {
+        // Both mappings must cover whole pages, so round up to the mirror granularity
+        size_t granularity = audio_ring_memory::getMirrorGranularity(frameSize);
+        frameCount = ((frameCount + granularity - 1) / granularity) * granularity;
+    }
+    if (frameCount * frameSize != bufferSizeBytes) {
+        LOG_WARN("Ring buffer size rounded to " + std::to_string(frameCount) + " microframes");
+    }
+    
+    std::unique_ptr<ring_generation> generation(new ring_generation());
+    audio_ring_memory& memory = generation->memory;
+    if (!config.sharedName.empty()) {
+        std::unique_ptr<audio_shm_segment> segment(new audio_shm_segment());
+        if (!segment->create(config.sharedName, frameSize, frameCount, config.backing == audio_rb_backing::mirrored,
+                             config.frameMetadata, config.sharedFormat,
+                             static_cast<int64_t>(config.peerTimeoutMicros) * 1000)) {
+            return std::unique_ptr<ring_generation>();
+        }
+        shared_segment = std::move(segment);
+        if (!mapSharedMemory(memory, config.memoryOptions)) {
+            shared_segment.reset();
+            return std::unique_ptr<ring_generation>();
+        }
+    } else if (!memory.allocate(frameCount * frameSize, config.backing, config.memoryOptions)) {
+        LOG_ERROR("Failed to allocate ring buffer memory");
+        return std::unique_ptr<ring_generation>();
+    }
+    
+    if (!memory.isMirrored() && config.backing == audio_rb_backing::mirrored) {
+        // Heap fallback keeps the rounded geometry; acquires just clip at the wrap again
+        LOG_WARN("Ring buffer running without mirroring");
+    }
+    
+    audio_frame_ring_indices* sharedIndices = nullptr;
+    audio_frame_meta* frameMeta = nullptr;
+    if (shared_segment) {
+        sharedIndices = shared_segment->getIndices();
+        frameMeta = shared_segment->getFrameMeta();
+    } else if (config.frameMetadata) {
+        generation->meta.resize(frameCount);
+        frameMeta = &generation->meta[0];
+    }
+    if (!generation->ring.initialize(memory.getData(), frameSize, frameCount, memory.isMirrored(), 
+                                     sharedIndices, frameMeta)) {
+        LOG_ERROR("Failed to initialize microframe ring buffer");
+        return std::unique_ptr<ring_generation>();
+    }
+    
+    if (notifier) {
+        generation->ring.setNotifier(notifier.get());
+    }
+    
+    LOG_INFO("✅ Ring buffer initialized: " + std::to_string(frameCount * frameSize) + " bytes (" + 
+             std::to_string(frameCount) + " × " + std::to_string(frameSize) + " byte microframes" + 
+             (memory.isMirrored() ? ", mirrored)" : ")"));
+    
+    if (config.memoryOptions.hugePages || config.memoryOptions.lockPages || config.memoryOptions.prefault) {
+        audio_page_faults faults = memory.getPrefaultFaults();
+        LOG_INFO("   Ring memory: huge pages " + std::string(memory.usesHugePages() ? "yes" : "no") + 
+                 ", locked " + std::string(memory.isLocked() ? "yes" : "no") + 
+                 ", prefault faults " + std::to_string(faults.minor) + " minor / " + 
+                 std::to_string(faults.major) + " major");
+    }
+    return generation;
+}
+
+bool audio_rb_controller::mapSharedMemory(audio_ring_memory& memory, const audio_ring_memory_options& options) {
+    size_t bytes = shared_segment->getFrameSize() * shared_segment->getFrameCount();
+    if (!memory.mapShared(shared_segment->getFd(), shared_segment->getDataOffset(), bytes, 
+                          shared_segment->isMirrored(), options)) {
+        LOG_ERROR("Failed to map shared ring memory for " + shared_segment->getName());
+        return false;
+    }
+    return true;
+}
+
+bool audio_rb_controller::attach(const std::string& segmentName, const audio_ring_memory_options& options) {
+    if (initialized) {
+        LOG_WARN("Ring buffer already initialized - detach first");
+        return false;
+    }
+    
+    std::unique_ptr<audio_shm_segment> segment(new audio_shm_segment());
+    if (!segment->attach(segmentName)) {
+        return false;
+    }
+    shared_segment = std::move(segment);
     
-    if (result != MA_SUCCESS) {
-        LOG_ERROR("Failed to initialize miniaudio ring buffer: " + std::to_string(result));
+    // Geometry comes from the producer's header, not from our own config
+    std::unique_ptr<ring_generation> generation(new ring_generation());
+    size_t frameSize = shared_segment->getFrameSize();
+    size_t frameCount = shared_segment->getFrameCount();
+    if (!mapSharedMemory(generation->memory, options) ||
+        !generation->ring.initialize(generation->memory.getData(), frameSize, frameCount, 
+                                     generation->memory.isMirrored(), shared_segment->getIndices(),
+                                     shared_segment->getFrameMeta())) {
+        generation.reset();
+        shared_segment.reset();
         return false;
     }
     
+    config = audio_rb_config();
+    config.frameSize = frameSize;
+    config.backing = generation->memory.getBacking();
+    config.memoryOptions = options;
+    config.sharedName = segmentName;
+    config.sharedFormat = shared_segment->getFormat();
+    config.frameMetadata = shared_segment->getFrameMeta() != nullptr;
+    
+    fill_telemetry.initialize(frameCount);
+    write_generation.store(generation.get());
+    read_generation.store(generation.get());
+    generations.push_back(std::move(generation));
     initialized = true;
-    LOG_INFO("✅ Ring buffer initialized: " + std::to_string(bufferSizeBytes) + " bytes");
+    
+    LOG_INFO("🔗 Attached to shared ring " + segmentName + ": " + std::to_string(frameCount) + " × " + 
+             std::to_string(frameSize) + " byte microframes" + 
+             (config.backing == audio_rb_backing::mirrored ? ", mirrored" : ""));
+    return true;
+}
+
+void audio_rb_controller::detach() {
+    std::lock_guard<std::mutex> lock(resize_mutex);
+    
+    write_generation.store(nullptr);
+    read_generation.store(nullptr);
+    pending_generation.store(nullptr);
+    claimed_lanes.store(0);
+    initialized = false;
+    
+    // Slots first, then the header that holds the shared indices
+    generations.clear();
+    extra_lanes.clear();
+    shared_segment.reset();
+}
+
+bool audio_rb_controller::isShared() const {
+    return shared_segment != nullptr;
+}
+
+const audio_shm_segment* audio_rb_controller::getSharedSegment() const {
+    return shared_segment.get();
+}
+
+void audio_rb_controller::heartbeat() {
+    if (shared_segment) {
+        shared_segment->heartbeat();
+    }
+}
+
+audio_shm_peer_state audio_rb_controller::getPeerState() const {
+    if (!shared_segment) {
+        return audio_shm_peer_state::alive;
+    }
+    return shared_segment->getPeerState(static_cast<int64_t>(config.peerTimeoutMicros) * 1000);
+}
+
+bool audio_rb_controller::isPeerGone() const {
+    return shared_segment && getPeerState() == audio_shm_peer_state::gone;
+}
+
+bool audio_rb_controller::resize(size_t newBufferSizeBytes) {
+    if (!initialized) {
+        LOG_ERROR("Cannot resize - ring buffer not initialized");
+        return false;
+    }
+    
+    if (shared_segment) {
+        // The peer process has the old geometry mapped; it cannot follow a swap
+        LOG_ERROR("Cannot resize a shared ring buffer");
+        return false;
+    }
+    
+    if (!extra_lanes.empty()) {
+        // Lanes would have to switch together to keep the mix aligned
+        LOG_ERROR("Cannot resize a fan-in ring buffer");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(resize_mutex);
+    
+    if (pending_generation.load() != nullptr) {
+        LOG_WARN("Ring resize already pending");
+        return false;
+    }
+    
+    reclaimRetiredGenerations();
+    
+    // Allocation, locking and prefaulting all happen here, off the streaming threads
+    std::unique_ptr<ring_generation> generation = createGeneration(newBufferSizeBytes);
+    if (!generation) {
+        return false;
+    }
+    
+    LOG_INFO("🔁 Ring resize queued: " + std::to_string(getFrameCapacity()) + " → " + 
+             std::to_string(generation->ring.getFrameCount()) + " microframes");
+    pending_generation.store(generation.get(), std::memory_order_release);
+    generations.push_back(std::move(generation));
     return true;
 }
 
-ma_rb* audio_rb_controller::getRingBuffer() {
-    return initialized ? &ring_buffer : nullptr;
+bool audio_rb_controller::isResizePending() const {
+    return pending_generation.load() != nullptr;
+}
+
+void audio_rb_controller::reclaimRetiredGenerations() {
+    // Retired rings have been drained by the consumer and left by the producer
+    std::vector<std::unique_ptr<ring_generation> > live;
+    for (size_t i = 0; i < generations.size(); ++i) {
+        if (!generations[i]->retired.load(std::memory_order_acquire)) {
+            live.push_back(std::move(generations[i]));
+        }
+    }
+    generations.swap(live);
+}
+
+audio_frame_ring* audio_rb_controller::syncWriteRing(audio_frame_ring* current) {
+    // Cheap check first: the pending pointer is only written on resize
+    if (pending_generation.load(std::memory_order_relaxed) == nullptr) {
+        return current;
+    }
+    
+    ring_generation* next = pending_generation.exchange(nullptr, std::memory_order_acquire);
+    if (!next) {
+        return current;
+    }
+    
+    // Everything committed to the old ring so far is published before the link
+    ring_generation* previous = write_generation.load(std::memory_order_relaxed);
+    previous->next.store(next, std::memory_order_release);
+    write_generation.store(next, std::memory_order_release);
+    return &next->ring;
+}
+
+audio_frame_ring* audio_rb_controller::syncReadRing(audio_frame_ring* current) {
+    ring_generation* generation = read_generation.load(std::memory_order_relaxed);
+    ring_generation* next = generation->next.load(std::memory_order_acquire);
+    if (!next) {
+        return current;
+    }
+    
+    // The producer links only after its last commit, so an empty ring here is final
+    if (generation->ring.availableRead() != 0) {
+        return current;
+    }
+    
+    generation->retired.store(true, std::memory_order_release);
+    read_generation.store(next, std::memory_order_release);
+    fill_telemetry.initialize(next->ring.getFrameCount());
+    return &next->ring;
+}
+
+audio_frame_ring* audio_rb_controller::getRingBuffer() {
+    return getWriteRing();
+}
+
+audio_frame_ring* audio_rb_controller::getWriteRing() {
+    return initialized ? &write_generation.load()->ring : nullptr;
+}
+
+audio_frame_ring* audio_rb_controller::getReadRing() {
+    return initialized ? &read_generation.load()->ring : nullptr;
 }
 
 bool audio_rb_controller::isInitialized() const { 
@@ -42,7 +354,132 @@ bool audio_rb_controller::isInitialized() const {
 }
 
 size_t audio_rb_controller::getBufferSize() const { 
-    return buffer_size_bytes; 
+    return getFrameCapacity() * config.frameSize; 
+}
+
+size_t audio_rb_controller::getFrameSize() const {
+    return config.frameSize;
+}
+
+size_t audio_rb_controller::getFrameCapacity() const {
+    return initialized ? write_generation.load()->ring.getFrameCount() : 0;
+}
+
+const audio_rb_config& audio_rb_controller::getConfig() const {
+    return config;
+}
+
+const audio_ring_memory& audio_rb_controller::getRingMemory() const {
+    return write_generation.load()->memory;
+}
+
+audio_fill_telemetry& audio_rb_controller::getFillTelemetry() {
+    return fill_telemetry;
+}
+
+size_t audio_rb_controller::getProducerLaneCount() const {
+    return initialized ? extra_lanes.size() + 1 : 0;
+}
+
+int audio_rb_controller::claimProducerLane() {
+    size_t laneCount = getProducerLaneCount();
+    uint64_t claimed = claimed_lanes.load();
+    for (size_t lane = 0; lane < laneCount; ++lane) {
+        uint64_t bit = static_cast<uint64_t>(1) << lane;
+        if (claimed & bit) continue;
+        if (claimed_lanes.compare_exchange_strong(claimed, claimed | bit)) {
+            return static_cast<int>(lane);
+        }
+        // Lost a race: rescan with the fresh mask
+        lane = static_cast<size_t>(-1);
+    }
+    return -1;
+}
+
+void audio_rb_controller::releaseProducerLane(int lane) {
+    if (lane < 0 || lane >= 64) return;
+    claimed_lanes.fetch_and(~(static_cast<uint64_t>(1) << lane));
+}
+
+bool audio_rb_controller::enableNotifications(size_t readThresholdFrames, size_t writeThresholdFrames) {
+    if (!initialized) {
+        LOG_ERROR("Cannot enable notifications - ring buffer not initialized");
+        return false;
+    }
+    if (shared_segment) {
+        // The opposite side commits from another process and cannot reach our eventfds
+        LOG_ERROR("Notifications are not supported on shared ring buffers");
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(resize_mutex);
+    if (!notifier) {
+        std::unique_ptr<audio_ring_notifier> created(new audio_ring_notifier());
+        if (!created->initialize(readThresholdFrames, writeThresholdFrames)) {
+            return false;
+        }
+        notifier = std::move(created);
+    } else if (!notifier->initialize(readThresholdFrames, writeThresholdFrames)) {
+        return false;
+    }
+    
+    // Every ring that can still be committed to reports to the same pair of fds
+    for (size_t i = 0; i < generations.size(); ++i) {
+        generations[i]->ring.setNotifier(notifier.get());
+    }
+    for (size_t i = 0; i < extra_lanes.size(); ++i) {
+        extra_lanes[i]->ring.setNotifier(notifier.get());
+    }
+    
+    LOG_INFO("🔔 Ring notifications: readable at " + std::to_string(notifier->getReadThreshold()) + 
+             " microframes, writable at " + std::to_string(notifier->getWriteThreshold()) + " free");
+    return true;
+}
+
+int audio_rb_controller::getReadableFd() const {
+    return notifier ? notifier->getReadableFd() : -1;
+}
+
+int audio_rb_controller::getWritableFd() const {
+    return notifier ? notifier->getWritableFd() : -1;
+}
+
+bool audio_rb_controller::armReadable() {
+    if (!notifier || !initialized) return false;
+    
+    notifier->armReadable();
+    // Re-check after arming: a commit that raced the arm may not have seen it
+    size_t threshold = notifier->getReadThreshold();
+    for (size_t lane = 0; lane < getProducerLaneCount(); ++lane) {
+        audio_frame_ring* ring = getReadRing(lane);
+        if (ring->availableRead() / ring->getFrameSize() >= threshold) {
+            notifier->disarmReadable();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool audio_rb_controller::armWritable() {
+    if (!notifier || !initialized) return false;
+    
+    notifier->armWritable();
+    audio_frame_ring* ring = getWriteRing();
+    if (ring->availableWrite() / ring->getFrameSize() >= notifier->getWriteThreshold()) {
+        notifier->disarmWritable();
+        return true;
+    }
+    return false;
+}
+
+audio_frame_ring* audio_rb_controller::getWriteRing(size_t lane) {
+    if (lane == 0) return getWriteRing();
+    return (initialized && lane <= extra_lanes.size()) ? &extra_lanes[lane - 1]->ring : nullptr;
+}
+
+audio_frame_ring* audio_rb_controller::getReadRing(size_t lane) {
+    if (lane == 0) return getReadRing();
+    return (initialized && lane <= extra_lanes.size()) ? &extra_lanes[lane - 1]->ring : nullptr;
 }
 
 } // namespace kcobain 
\ No newline at end of file
@@ -1,29 +1,136 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 #include "../../include/kcobain/logger.h"
 #include "../../external/miniaudio.h"
+#include "audio_frame_ring.h"
+#include "audio_ring_memory.h"
+#include "audio_rb_telemetry.h"
+#include "audio_shm_segment.h"
+#include "audio_ring_notifier.h"
 
 namespace kcobain {
 
+/**
+ * @brief Ring buffer configuration
+ */
+struct audio_rb_config {
+    size_t frameSize;             // Bytes per microframe slot
+    audio_rb_backing backing;     // Memory backing for the slot storage
+    audio_ring_memory_options memoryOptions;  // Huge pages / mlock / prefault
+    std::string sharedName;       // Non-empty: place the ring in this POSIX shared memory segment
+    audio_shm_format sharedFormat;            // Format advertised to the attaching process
+    uint32_t peerTimeoutMicros;   // Heartbeat age after which the peer process is probed
+    bool frameMetadata;           // Keep a sequence/timestamp side channel beside the slots
+    size_t producerLanes;         // >1: fan-in mode, one SPSC sub-ring per producer (max 64)
+    
+    audio_rb_config() 
+        : frameSize(384), backing(audio_rb_backing::heap), peerTimeoutMicros(100000), frameMetadata(true),
+          producerLanes(1) {}
+};
+
 /**
  * @brief Audio Ring Buffer Controller
- * Manages the miniaudio ring buffer for audio data transfer
+ * Manages the microframe ring buffer for audio data transfer.
+ * 
+ * A live resize builds a new ring off the real-time path. The producer
+ * switches to it at its next microframe boundary and links it behind the
+ * old ring; the consumer drains the old ring before following the link,
+ * so buffered audio is preserved and the switch never starves the reader.
+ * 
+ * With a shared name the ring lives in a shared memory segment: the
+ * producer process initializes it, the consumer process attaches to it,
+ * and reads stay zero-copy across the process boundary. Shared rings are
+ * fixed size; resize is refused.
+ * 
+ * In fan-in mode every producer claims its own lane, an SPSC ring of the
+ * same size, and the single consumer merges the lanes; no producer ever
+ * shares a ring, so the data path stays lock-free. Fan-in rings are
+ * in-process and fixed size.
  */
 class audio_rb_controller {
 private:
-    ma_rb ring_buffer;
-    size_t buffer_size_bytes;
+    struct ring_generation {
+        audio_ring_memory memory;
+        std::vector<audio_frame_meta> meta;   // Per-slot side channel (in-process rings)
+        audio_frame_ring ring;
+        std::atomic<ring_generation*> next;   // Set by the producer when it moves on
+        std::atomic<bool> retired;            // Set by the consumer once drained
+        
+        ring_generation() : next(nullptr), retired(false) {}
+    };
+    
+    std::unique_ptr<audio_shm_segment> shared_segment;           // Set for cross-process rings
+    std::vector<std::unique_ptr<ring_generation> > generations;  // Owned rings, oldest first
+    std::vector<std::unique_ptr<ring_generation> > extra_lanes;  // Fan-in lanes 1..N-1
+    std::atomic<uint64_t> claimed_lanes;                         // Bit per lane owned by a producer
+    std::unique_ptr<audio_ring_notifier> notifier;               // eventfd readiness, when enabled
+    std::atomic<ring_generation*> write_generation;              // Ring the producer writes
+    std::atomic<ring_generation*> read_generation;               // Ring the consumer reads
+    std::atomic<ring_generation*> pending_generation;            // Resize target not yet picked up
+    std::mutex resize_mutex;                                     // Serialises control-plane resizes
+    audio_fill_telemetry fill_telemetry;
+    audio_rb_config config;
     bool initialized;
+    
+    std::unique_ptr<ring_generation> createGeneration(size_t bufferSizeBytes);
+    void reclaimRetiredGenerations();
+    bool mapSharedMemory(audio_ring_memory& memory, const audio_ring_memory_options& options);
 
 public:
     audio_rb_controller();
     ~audio_rb_controller();
     
-    bool initialize(size_t bufferSizeBytes);
-    ma_rb* getRingBuffer();
+    bool initialize(size_t bufferSizeBytes, size_t frameSize = 384);
+    bool initialize(size_t bufferSizeBytes, const audio_rb_config& rbConfig);
+    audio_frame_ring* getRingBuffer();
     bool isInitialized() const;
     size_t getBufferSize() const;
+    size_t getFrameSize() const;
+    size_t getFrameCapacity() const;
+    const audio_rb_config& getConfig() const;
+    const audio_ring_memory& getRingMemory() const;
+    audio_fill_telemetry& getFillTelemetry();
+    
+    // Fan-in lanes; lane 0 is the ring returned by getWriteRing()/getReadRing()
+    size_t getProducerLaneCount() const;
+    int claimProducerLane();                       // -1 when every lane is taken
+    void releaseProducerLane(int lane);
+    audio_frame_ring* getWriteRing(size_t lane);
+    audio_frame_ring* getReadRing(size_t lane);
+    
+    // epoll readiness (in-process rings); enable before streaming starts.
+    // arm*() returns true when the condition already holds - don't sleep then.
+    bool enableNotifications(size_t readThresholdFrames, size_t writeThresholdFrames);
+    int getReadableFd() const;
+    int getWritableFd() const;
+    bool armReadable();
+    bool armWritable();
+    
+    // Cross-process rings (consumer side); detach only once streaming has stopped
+    bool attach(const std::string& segmentName,
+                const audio_ring_memory_options& options = audio_ring_memory_options());
+    void detach();
+    bool isShared() const;
+    const audio_shm_segment* getSharedSegment() const;
+    void heartbeat();                              // Streaming threads, once per wake-up
+    audio_shm_peer_state getPeerState() const;
+    bool isPeerGone() const;                       // Always false for an in-process ring
+    
+    // Live resize (control plane); takes effect at the producer's next microframe
+    bool resize(size_t newBufferSizeBytes);
+    bool isResizePending() const;
+    
+    // Ring hand-off for the streaming threads
+    audio_frame_ring* getWriteRing();
+    audio_frame_ring* getReadRing();
+    audio_frame_ring* syncWriteRing(audio_frame_ring* current);   // Producer, between microframes
+    audio_frame_ring* syncReadRing(audio_frame_ring* current);    // Consumer, when the ring looks empty
 };
 
 } // namespace kcobain 
\ No newline at end of file
@@ -0,0 +1,271 @@
+#include "audio_rb_telemetry.h"
+
+namespace kcobain {
+
+namespace {
+
+const uint32_t NO_MIN_FILL = 0xFFFFFFFFu;
+const uint64_t NO_MIN_LATENCY = ~static_cast<uint64_t>(0);
+
+unsigned highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+    unsigned bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+// Single-writer increment: a plain load and store, no locked read-modify-write
+inline void bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+} // namespace
+
+audio_fill_telemetry::audio_fill_telemetry()
+    : capacity(0), current_fill(0), interval_min(NO_MIN_FILL), interval_max(0), samples(0) {
+    for (size_t i = 0; i < audio_fill_snapshot::HISTOGRAM_BUCKETS; ++i) {
+        histogram[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void audio_fill_telemetry::initialize(size_t capacityFrames) {
+    capacity.store(static_cast<uint32_t>(capacityFrames), std::memory_order_relaxed);
+    current_fill.store(0, std::memory_order_relaxed);
+    interval_min.store(NO_MIN_FILL, std::memory_order_relaxed);
+    interval_max.store(0, std::memory_order_relaxed);
+    resetHistogram();
+}
+
+void audio_fill_telemetry::record(size_t fillFrames) {
+    uint32_t fill = static_cast<uint32_t>(fillFrames);
+    current_fill.store(fill, std::memory_order_relaxed);
+    
+    // CAS loops rather than plain stores so a concurrent interval reset is never undone
+    uint32_t seen = interval_min.load(std::memory_order_relaxed);
+    while (fill < seen && !interval_min.compare_exchange_weak(seen, fill, std::memory_order_relaxed)) {
+    }
+    seen = interval_max.load(std::memory_order_relaxed);
+    while (fill > seen && !interval_max.compare_exchange_weak(seen, fill, std::memory_order_relaxed)) {
+    }
+    
+    size_t bucket = static_cast<size_t>(fill) * audio_fill_snapshot::HISTOGRAM_BUCKETS / 
+                    (capacity.load(std::memory_order_relaxed) + 1);
+    if (bucket >= audio_fill_snapshot::HISTOGRAM_BUCKETS) {
+        bucket = audio_fill_snapshot::HISTOGRAM_BUCKETS - 1;
+    }
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint32_t audio_fill_telemetry::getCurrentFill() const {
+    return current_fill.load(std::memory_order_relaxed);
+}
+
+audio_fill_snapshot audio_fill_telemetry::snapshot() const {
+    audio_fill_snapshot snap;
+    snap.capacity = capacity.load(std::memory_order_relaxed);
+    snap.currentFill = current_fill.load(std::memory_order_relaxed);
+    uint32_t minFill = interval_min.load(std::memory_order_relaxed);
+    snap.intervalMinFill = (minFill == NO_MIN_FILL) ? 0 : minFill;
+    snap.intervalMaxFill = interval_max.load(std::memory_order_relaxed);
+    snap.samples = samples.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < audio_fill_snapshot::HISTOGRAM_BUCKETS; ++i) {
+        snap.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+audio_fill_snapshot audio_fill_telemetry::takeInterval() {
+    audio_fill_snapshot snap = snapshot();
+    uint32_t minFill = interval_min.exchange(NO_MIN_FILL, std::memory_order_relaxed);
+    snap.intervalMinFill = (minFill == NO_MIN_FILL) ? 0 : minFill;
+    snap.intervalMaxFill = interval_max.exchange(0, std::memory_order_relaxed);
+    return snap;
+}
+
+void audio_fill_telemetry::resetHistogram() {
+    for (size_t i = 0; i < audio_fill_snapshot::HISTOGRAM_BUCKETS; ++i) {
+        histogram[i].store(0, std::memory_order_relaxed);
+    }
+    samples.store(0, std::memory_order_relaxed);
+}
+
+size_t audio_latency_snapshot::bucketIndex(uint64_t valueNs) {
+    if (valueNs < SUB_BUCKETS) return static_cast<size_t>(valueNs);
+    unsigned msb = highestBit(valueNs);
+    if (msb >= MAX_VALUE_BITS) return HISTOGRAM_BUCKETS - 1;
+    // The top SUB_BUCKET_BITS + 1 bits select the bucket within the value's power of two
+    unsigned shift = msb - static_cast<unsigned>(SUB_BUCKET_BITS);
+    return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((valueNs >> shift) - SUB_BUCKETS);
+}
+
+uint64_t audio_latency_snapshot::bucketUpperNs(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket + 1;
+    size_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t subBucket = bucket % SUB_BUCKETS + SUB_BUCKETS;
+    return (subBucket + 1) << shift;
+}
+
+audio_latency_histogram::audio_latency_histogram() {
+    reset();
+}
+
+void audio_latency_histogram::record(uint64_t valueNs) {
+    bump(counts[audio_latency_snapshot::bucketIndex(valueNs)], 1);
+    bump(samples, 1);
+    bump(total_ns, valueNs);
+    if (valueNs > max_ns.load(std::memory_order_relaxed)) max_ns.store(valueNs, std::memory_order_relaxed);
+    if (valueNs < min_ns.load(std::memory_order_relaxed)) min_ns.store(valueNs, std::memory_order_relaxed);
+    
+    // CAS loops rather than plain stores so a concurrent interval reset is never undone
+    uint64_t seen = interval_max_ns.load(std::memory_order_relaxed);
+    while (valueNs > seen && !interval_max_ns.compare_exchange_weak(seen, valueNs, std::memory_order_relaxed)) {
+    }
+    seen = interval_min_ns.load(std::memory_order_relaxed);
+    while (valueNs < seen && !interval_min_ns.compare_exchange_weak(seen, valueNs, std::memory_order_relaxed)) {
+    }
+}
+
+void audio_latency_histogram::snapshot(audio_latency_snapshot* pSnapshot) const {
+    pSnapshot->samples = samples.load(std::memory_order_relaxed);
+    uint64_t minLatency = min_ns.load(std::memory_order_relaxed);
+    pSnapshot->minNs = (minLatency == NO_MIN_LATENCY) ? 0 : minLatency;
+    pSnapshot->maxNs = max_ns.load(std::memory_order_relaxed);
+    pSnapshot->totalNs = total_ns.load(std::memory_order_relaxed);
+    pSnapshot->gaps = 0;
+    pSnapshot->lostFrames = 0;
+    pSnapshot->reordered = 0;
+    for (size_t i = 0; i < audio_latency_snapshot::HISTOGRAM_BUCKETS; ++i) {
+        pSnapshot->histogram[i] = counts[i].load(std::memory_order_relaxed);
+    }
+}
+
+void audio_latency_histogram::takeInterval(audio_latency_snapshot* pSnapshot) {
+    for (size_t i = 0; i < audio_latency_snapshot::HISTOGRAM_BUCKETS; ++i) {
+        uint64_t count = counts[i].load(std::memory_order_relaxed);
+        pSnapshot->histogram[i] = count - baseline_counts[i];
+        baseline_counts[i] = count;
+    }
+    uint64_t totalSamples = samples.load(std::memory_order_relaxed);
+    pSnapshot->samples = totalSamples - baseline_samples;
+    baseline_samples = totalSamples;
+    uint64_t totalNs = total_ns.load(std::memory_order_relaxed);
+    pSnapshot->totalNs = totalNs - baseline_total_ns;
+    baseline_total_ns = totalNs;
+    
+    uint64_t minLatency = interval_min_ns.exchange(NO_MIN_LATENCY, std::memory_order_relaxed);
+    pSnapshot->minNs = (minLatency == NO_MIN_LATENCY) ? 0 : minLatency;
+    pSnapshot->maxNs = interval_max_ns.exchange(0, std::memory_order_relaxed);
+    pSnapshot->gaps = 0;
+    pSnapshot->lostFrames = 0;
+    pSnapshot->reordered = 0;
+}
+
+void audio_latency_histogram::reset() {
+    for (size_t i = 0; i < audio_latency_snapshot::HISTOGRAM_BUCKETS; ++i) {
+        counts[i].store(0, std::memory_order_relaxed);
+        baseline_counts[i] = 0;
+    }
+    samples.store(0, std::memory_order_relaxed);
+    total_ns.store(0, std::memory_order_relaxed);
+    min_ns.store(NO_MIN_LATENCY, std::memory_order_relaxed);
+    max_ns.store(0, std::memory_order_relaxed);
+    interval_min_ns.store(NO_MIN_LATENCY, std::memory_order_relaxed);
+    interval_max_ns.store(0, std::memory_order_relaxed);
+    baseline_samples = 0;
+    baseline_total_ns = 0;
+}
+
+audio_latency_telemetry::audio_latency_telemetry()
+    : gaps(0), lost_frames(0), reordered(0), expected_sequence(0), has_sequence(false) {
+}
+
+void audio_latency_telemetry::record(uint64_t sequence, int64_t latencyNs) {
+    // Sequence check: a jump forward is loss, a step back is reordering
+    if (has_sequence && sequence != expected_sequence) {
+        if (sequence > expected_sequence) {
+            gaps.fetch_add(1, std::memory_order_relaxed);
+            lost_frames.fetch_add(sequence - expected_sequence, std::memory_order_relaxed);
+        } else {
+            reordered.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!has_sequence || sequence >= expected_sequence) {
+        expected_sequence = sequence + 1;
+        has_sequence = true;
+    }
+    
+    // Both sides use the same steady clock; clamp tiny negative skews to zero
+    latency.record(latencyNs > 0 ? static_cast<uint64_t>(latencyNs) : 0);
+}
+
+audio_latency_snapshot audio_latency_telemetry::snapshot() const {
+    audio_latency_snapshot snap;
+    latency.snapshot(&snap);
+    snap.gaps = gaps.load(std::memory_order_relaxed);
+    snap.lostFrames = lost_frames.load(std::memory_order_relaxed);
+    snap.reordered = reordered.load(std::memory_order_relaxed);
+    return snap;
+}
+
+audio_latency_snapshot audio_latency_telemetry::takeInterval() {
+    audio_latency_snapshot snap;
+    latency.takeInterval(&snap);
+    snap.gaps = gaps.load(std::memory_order_relaxed);
+    snap.lostFrames = lost_frames.load(std::memory_order_relaxed);
+    snap.reordered = reordered.load(std::memory_order_relaxed);
+    return snap;
+}
+
+void audio_latency_telemetry::reset() {
+    latency.reset();
+    gaps.store(0, std::memory_order_relaxed);
+    lost_frames.store(0, std::memory_order_relaxed);
+    reordered.store(0, std::memory_order_relaxed);
+    expected_sequence = 0;
+    has_sequence = false;
+}
+
+void audio_latency_snapshot::merge(const audio_latency_snapshot& other) {
+    if (other.samples > 0 && (samples == 0 || other.minNs < minNs)) {
+        minNs = other.minNs;
+    }
+    if (other.maxNs > maxNs) {
+        maxNs = other.maxNs;
+    }
+    samples += other.samples;
+    totalNs += other.totalNs;
+    gaps += other.gaps;
+    lostFrames += other.lostFrames;
+    reordered += other.reordered;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        histogram[i] += other.histogram[i];
+    }
+}
+
+uint64_t audio_latency_snapshot::percentileNs(double percentile) const {
+    if (samples == 0) return 0;
+    
+    uint64_t total = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        total += histogram[i];
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(total));
+    if (rank >= total) rank = total - 1;
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+        seen += histogram[i];
+        if (seen > rank) {
+            // Highest value the bucket can hold, but never past the largest actually observed
+            uint64_t upper = bucketUpperNs(i) - 1;
+            return upper < maxNs ? upper : maxNs;
+        }
+    }
+    return maxNs;
+}
+
+} // namespace kcobain
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace kcobain {
+
+/**
+ * @brief Snapshot of ring fill telemetry
+ * Fill levels are in microframes.
+ */
+struct audio_fill_snapshot {
+    static const size_t HISTOGRAM_BUCKETS = 16;
+    
+    uint32_t capacity;                      // Ring capacity in microframes
+    uint32_t currentFill;                   // Fill at the latest consumer read
+    uint32_t intervalMinFill;               // Lowest fill since the last interval reset
+    uint32_t intervalMaxFill;               // Highest fill since the last interval reset
+    uint64_t samples;                       // Reads sampled since the last histogram reset
+    uint64_t histogram[HISTOGRAM_BUCKETS];  // Bucket i covers fills [i*(capacity+1)/16, (i+1)*(capacity+1)/16)
+};
+
+/**
+ * @brief Ring fill telemetry
+ * Sampled by the consumer on every read; all counters are relaxed atomics so
+ * any thread can snapshot or reset while the stream keeps running.
+ */
+class audio_fill_telemetry {
+private:
+    std::atomic<uint32_t> capacity;
+    std::atomic<uint32_t> current_fill;
+    std::atomic<uint32_t> interval_min;
+    std::atomic<uint32_t> interval_max;
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> histogram[audio_fill_snapshot::HISTOGRAM_BUCKETS];
+
+public:
+    audio_fill_telemetry();
+    
+    void initialize(size_t capacityFrames);
+    void record(size_t fillFrames);
+    
+    uint32_t getCurrentFill() const;
+    audio_fill_snapshot snapshot() const;
+    audio_fill_snapshot takeInterval();   // Snapshot, then restart min/max
+    void resetHistogram();
+};
+
+/**
+ * @brief Snapshot of a latency distribution
+ * Latency is producer commit → consumer read (or wake-up minus deadline for
+ * the consumer's timer), in nanoseconds of steady clock. The histogram is
+ * log-linear: values below 64ns have exact buckets, above that every power
+ * of two is split into 32 linear sub-buckets, so any bucket is within ~3%
+ * of the values it holds, up to 2^40 ns (18 minutes).
+ */
+struct audio_latency_snapshot {
+    static const size_t SUB_BUCKET_BITS = 5;
+    static const size_t SUB_BUCKETS = static_cast<size_t>(1) << SUB_BUCKET_BITS;
+    static const size_t MAX_VALUE_BITS = 40;
+    static const size_t HISTOGRAM_BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    
+    uint64_t samples;                       // Values recorded
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint64_t totalNs;
+    uint64_t gaps;                          // Sequence jumps (one or more frames missing)
+    uint64_t lostFrames;                    // Frames skipped across all gaps
+    uint64_t reordered;                     // Frames older than one already seen
+    uint64_t histogram[HISTOGRAM_BUCKETS];  // See bucketIndex()
+    
+    static size_t bucketIndex(uint64_t valueNs);
+    static uint64_t bucketUpperNs(size_t bucket);      // Exclusive upper bound of a bucket's values
+    
+    uint64_t percentileNs(double percentile) const;   // Upper bound of the bucket holding the percentile
+    void merge(const audio_latency_snapshot& other);   // Fold in another stream or lane
+};
+
+/**
+ * @brief Fixed-memory, lock-free log-linear latency histogram
+ * record() is for a single writer thread and costs a handful of
+ * uncontended loads and stores, so it stays on for every microframe.
+ * Any thread may take cumulative snapshots while it runs. One reader may
+ * also take intervals: counts since its previous takeInterval(), computed
+ * against a baseline it keeps, so the writer is never paused or reset.
+ */
+class audio_latency_histogram {
+private:
+    std::atomic<uint64_t> counts[audio_latency_snapshot::HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> min_ns;
+    std::atomic<uint64_t> max_ns;
+    std::atomic<uint64_t> interval_min_ns;  // CAS by the writer, exchanged by the interval reader
+    std::atomic<uint64_t> interval_max_ns;
+    uint64_t baseline_counts[audio_latency_snapshot::HISTOGRAM_BUCKETS];  // Interval reader only
+    uint64_t baseline_samples;
+    uint64_t baseline_total_ns;
+    
+public:
+    audio_latency_histogram();
+    
+    void record(uint64_t valueNs);
+    // Everything since construction or reset(); fills the distribution fields only
+    void snapshot(audio_latency_snapshot* pSnapshot) const;
+    // Since the previous call (or reset()), then starts the next interval
+    void takeInterval(audio_latency_snapshot* pSnapshot);
+    // Only while no thread is recording
+    void reset();
+};
+
+/**
+ * @brief Microframe latency and sequence telemetry
+ * Recorded by the consumer for every frame that carries metadata; counters
+ * are relaxed atomics so statistics can be read while streaming.
+ */
+class audio_latency_telemetry {
+private:
+    audio_latency_histogram latency;
+    std::atomic<uint64_t> gaps;
+    std::atomic<uint64_t> lost_frames;
+    std::atomic<uint64_t> reordered;
+    uint64_t expected_sequence;             // Consumer thread only
+    bool has_sequence;
+
+public:
+    audio_latency_telemetry();
+    
+    void record(uint64_t sequence, int64_t latencyNs);
+    audio_latency_snapshot snapshot() const;
+    audio_latency_snapshot takeInterval();  // Latency since the previous call; sequence counters are cumulative
+    void reset();
+};
+
+} // namespace kcobain
@@ -0,0 +1,286 @@
+#include "audio_replay_producer.h"
+#include "audio_rb_controller.h"
+#include "../../include/kcobain/logger.h"
+#include "../../external/miniaudio.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace kcobain {
+
+audio_replay_producer::audio_replay_producer(audio_rb_controller* controller, audio_capture_reader* captureReader,
+                                             const audio_replay_config& replayConfig)
+    : buffer_controller(controller), reader(captureReader), config(replayConfig), running(false), finished(false),
+      lane(-1), total_frames_produced(0), truncated_packets(0), page_fault_count(0), loops_completed(0),
+      backpressure_waits(0), wakeup_count(0), wake_latency_total_ns(0), wake_latency_max_ns(0) {
+
+    if (config.batchFrames == 0) config.batchFrames = 1;
+    if (config.speed <= 0.0) {
+        LOG_WARN("Replay speed must be positive - replaying at 1x");
+        config.speed = 1.0;
+    }
+
+    if (!reader || !reader->isOpen()) {
+        LOG_ERROR("Replay producer cannot be created - no open capture");
+        return;
+    }
+    if (!buffer_controller || !buffer_controller->isInitialized()) {
+        LOG_ERROR("Replay producer cannot be created - invalid or uninitialized buffer controller");
+        return;
+    }
+    if (config.batchFrames > buffer_controller->getFrameCapacity()) {
+        config.batchFrames = buffer_controller->getFrameCapacity();
+    }
+    if (reader->getSlotBytes() > buffer_controller->getFrameSize()) {
+        LOG_WARN("Capture slots are " + std::to_string(reader->getSlotBytes()) + " bytes, ring slots " +
+                 std::to_string(buffer_controller->getFrameSize()) + " - longer packets will be truncated");
+    }
+
+    lane = buffer_controller->claimProducerLane();
+    if (lane < 0) {
+        LOG_ERROR("Replay producer cannot be created - all " + std::to_string(buffer_controller->getProducerLaneCount()) +
+                  " producer lanes are taken");
+        return;
+    }
+
+    LOG_INFO("⏪ Replay producer: " + std::to_string(reader->getRecordCount()) + " captured microframes (lane " +
+             std::to_string(config.captureLane) + "), " +
+             (config.mode == audio_replay_mode::max_speed ? std::string("max speed")
+                                                          : std::to_string(config.speed) + "x realtime") +
+             (config.loop ? ", looping" : ""));
+}
+
+audio_replay_producer::~audio_replay_producer() {
+    stop();
+    if (buffer_controller && lane >= 0) {
+        buffer_controller->releaseProducerLane(lane);
+    }
+}
+
+void audio_replay_producer::start() {
+    if (running.load()) return;
+
+    if (!buffer_controller || !buffer_controller->isInitialized() || lane < 0 || !reader || !reader->isOpen()) {
+        LOG_ERROR("Cannot start replay - no capture or buffer controller lane");
+        return;
+    }
+
+    reader->rewind();
+    finished = false;
+    running = true;
+    LOG_INFO("⏪ Replay started");
+    producer_thread = std::thread([this]() { producerLoop(); });
+}
+
+void audio_replay_producer::stop() {
+    if (!running.load()) return;
+
+    running = false;
+    if (producer_thread.joinable()) {
+        producer_thread.join();
+    }
+    LOG_INFO("⏪ Replay stopped after " + std::to_string(total_frames_produced.load()) + " microframes");
+}
+
+bool audio_replay_producer::isRunning() const {
+    return running.load();
+}
+
+uint32_t audio_replay_producer::getTotalFramesProduced() const {
+    return total_frames_produced.load();
+}
+
+uint32_t audio_replay_producer::getOverrunCount() const {
+    // Backpressure waits instead of dropping, so a replay never overruns
+    return 0;
+}
+
+uint64_t audio_replay_producer::getPageFaultCount() const {
+    return page_fault_count.load();
+}
+
+uint64_t audio_replay_producer::getLoopAllocationCount() const {
+    return 0;
+}
+
+audio_wait_stats audio_replay_producer::getWaitStats() const {
+    audio_wait_stats stats;
+    stats.waits = backpressure_waits.load();
+    stats.wakeups = wakeup_count.load();
+    stats.totalWakeLatencyNs = wake_latency_total_ns.load();
+    stats.maxWakeLatencyNs = wake_latency_max_ns.load();
+    return stats;
+}
+
+audio_pacing_stats audio_replay_producer::getPacingStats() const {
+    return audio_pacing_stats();
+}
+
+void audio_replay_producer::setSource(iaudio_source* source) {
+    (void)source;
+    LOG_ERROR("A replay producer plays its capture - it takes no source");
+}
+
+iaudio_source* audio_replay_producer::getSource() const {
+    return nullptr;
+}
+
+void audio_replay_producer::setThreadPolicy(const audio_thread_policy& policy) {
+    if (running.load()) {
+        LOG_ERROR("Cannot change replay thread policy while streaming");
+        return;
+    }
+    thread_policy = policy;
+}
+
+audio_thread_policy_result audio_replay_producer::getThreadPolicyResult() const {
+    std::lock_guard<std::mutex> lock(thread_result_lock);
+    return thread_result;
+}
+
+bool audio_replay_producer::isFinished() const {
+    return finished.load();
+}
+
+uint64_t audio_replay_producer::getLoopsCompleted() const {
+    return loops_completed.load();
+}
+
+bool audio_replay_producer::nextRecord(audio_capture_record* pRecord) {
+    bool rewound = false;
+    for (;;) {
+        while (reader->next(pRecord)) {
+            if (pRecord->header.lane == config.captureLane) return true;
+        }
+        // A capture with nothing on the replayed lane would otherwise spin forever
+        if (!config.loop || rewound) return false;
+        reader->rewind();
+        loops_completed.fetch_add(1, std::memory_order_relaxed);
+        rewound = true;
+    }
+}
+
+void audio_replay_producer::waitForSpace(audio_frame_ring* ring, size_t frames) {
+    backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t wakeLatencyNs = -1;
+    ring->waitForWritable(frames, config.waitConfig, &wakeLatencyNs);
+    if (wakeLatencyNs >= 0) {
+        uint64_t latency = static_cast<uint64_t>(wakeLatencyNs);
+        wakeup_count.fetch_add(1, std::memory_order_relaxed);
+        wake_latency_total_ns.fetch_add(latency, std::memory_order_relaxed);
+        if (latency > wake_latency_max_ns.load(std::memory_order_relaxed)) {
+            wake_latency_max_ns.store(latency, std::memory_order_relaxed);
+        }
+    }
+}
+
+void audio_replay_producer::producerLoop() {
+    audio_frame_ring* ring_buffer = buffer_controller->getWriteRing(static_cast<size_t>(lane));
+    if (!ring_buffer) {
+        LOG_ERROR("Replay cannot start - no ring buffer available");
+        return;
+    }
+
+    audio_thread_policy_result policyResult = audio_apply_thread_policy(thread_policy, "Replay");
+    {
+        std::lock_guard<std::mutex> lock(thread_result_lock);
+        thread_result = policyResult;
+    }
+
+    audio_page_faults loopStartFaults = audio_ring_memory::getThreadPageFaults();
+    const bool realtime = config.mode == audio_replay_mode::realtime;
+    // Realtime: one microframe at a time, each when its captured commit time comes round
+    const size_t batchFrames = realtime ? 1 : config.batchFrames;
+    const int64_t microframeNs = static_cast<int64_t>(1e9 / reader->getFormat().microframesPerSecond / config.speed);
+
+    audio_capture_record record;
+    bool haveRecord = nextRecord(&record);
+    uint64_t passCount = loops_completed.load();
+    uint64_t sequenceOffset = 0;
+    uint64_t maxSequence = 0;
+    int64_t passOriginNs = audio_steady_time_ns();
+    int64_t firstCommitNs = haveRecord ? record.header.commit_time_ns : 0;
+    int64_t lastDueNs = passOriginNs;
+
+    while (running.load() && haveRecord) {
+        buffer_controller->heartbeat();
+        const size_t slotSize = ring_buffer->getFrameSize();
+
+        if (realtime) {
+            // Captured spacing, divided by the speed; a new pass continues one microframe after the last
+            int64_t dueNs = passOriginNs + static_cast<int64_t>((record.header.commit_time_ns - firstCommitNs) / config.speed);
+            int64_t nowNs = audio_steady_time_ns();
+            if (dueNs > nowNs) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(dueNs - nowNs));
+            }
+            lastDueNs = dueNs;
+        }
+
+        void* writeBuffer = nullptr;
+        size_t framesAcquired = 0;
+        ma_result result = MA_SUCCESS;
+        while (running.load()) {
+            framesAcquired = batchFrames;
+            result = ring_buffer->acquireWriteFrames(&framesAcquired, &writeBuffer);
+            if (result != MA_SUCCESS || framesAcquired > 0) break;
+            waitForSpace(ring_buffer, batchFrames);
+            buffer_controller->heartbeat();
+        }
+        if (result != MA_SUCCESS || framesAcquired == 0) {
+            if (result != MA_SUCCESS) LOG_ERROR("Replay cannot write - ring refused the microframes");
+            break;
+        }
+
+        // Copy the captured packets verbatim; the rest of each slot is silence
+        int64_t commitTimeNs = audio_steady_time_ns();
+        size_t framesFilled = 0;
+        while (framesFilled < framesAcquired && haveRecord) {
+            uint8_t* slot = static_cast<uint8_t*>(writeBuffer) + framesFilled * slotSize;
+            size_t packetBytes = record.header.payload_bytes;
+            if (packetBytes > slotSize) {
+                packetBytes = slotSize;
+                truncated_packets.fetch_add(1, std::memory_order_relaxed);
+            }
+            std::memcpy(slot, record.payload, packetBytes);
+            std::memset(slot + packetBytes, 0, slotSize - packetBytes);
+
+            if (ring_buffer->hasFrameMeta()) {
+                audio_frame_meta* meta = ring_buffer->getFrameMeta(slot);
+                meta->sequence = record.header.sequence + sequenceOffset;
+                meta->timestamp_ns = commitTimeNs;
+                meta->payload_bytes = static_cast<uint32_t>(packetBytes);
+            }
+            maxSequence = std::max(maxSequence, record.header.sequence);
+            ++framesFilled;
+
+            haveRecord = nextRecord(&record);
+            if (haveRecord && loops_completed.load(std::memory_order_relaxed) != passCount) {
+                // Looped: keep sequence numbers rising so the consumer sees no reordering
+                passCount = loops_completed.load(std::memory_order_relaxed);
+                sequenceOffset += maxSequence + 1;
+                maxSequence = 0;
+                passOriginNs = (realtime ? lastDueNs : audio_steady_time_ns()) + microframeNs;
+                firstCommitNs = record.header.commit_time_ns;
+            }
+            if (realtime) break;
+        }
+
+        ring_buffer->commitWriteFrames(framesFilled);
+        total_frames_produced.fetch_add(static_cast<uint32_t>(framesFilled));
+    }
+
+    audio_page_faults loopEndFaults = audio_ring_memory::getThreadPageFaults();
+    page_fault_count.store((loopEndFaults.minor - loopStartFaults.minor) +
+                           (loopEndFaults.major - loopStartFaults.major));
+    if (!haveRecord) {
+        finished = true;
+        LOG_INFO("⏪ Replay reached the end of the capture (" + std::to_string(total_frames_produced.load()) +
+                 " microframes)");
+    }
+    if (truncated_packets.load() > 0) {
+        LOG_WARN("Replay truncated " + std::to_string(truncated_packets.load()) + " packets to the ring slot size");
+    }
+}
+
+} // namespace kcobain
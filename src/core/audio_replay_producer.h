@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include "iaudio_producer.h"
+#include "audio_wait_strategy.h"
+#include "audio_capture.h"
+
+// Forward declaration
+namespace kcobain {
+    class audio_rb_controller;
+    class audio_frame_ring;
+}
+
+namespace kcobain {
+
+/**
+ * @brief How a capture is paced back into the ring
+ */
+enum class audio_replay_mode {
+    max_speed,      // As fast as the ring accepts microframes
+    realtime        // Each microframe at its captured commit time, scaled by speed
+};
+
+/**
+ * @brief Replay configuration
+ */
+struct audio_replay_config {
+    audio_replay_mode mode;
+    double speed;                   // Realtime only: 2.0 replays twice as fast as captured
+    bool loop;                      // Start over at the end instead of finishing
+    uint16_t captureLane;           // Which captured lane to replay
+    audio_wait_config waitConfig;   // How to wait when the ring is full
+    size_t batchFrames;             // Max-speed microframes per acquire/commit
+
+    audio_replay_config()
+        : mode(audio_replay_mode::max_speed), speed(1.0), loop(false), captureLane(0), batchFrames(8) {}
+};
+
+/**
+ * @brief Producer that replays a capture through the ring
+ * Payloads are copied verbatim into the slots, so the consumer decodes the
+ * exact bytes it saw when the capture was taken. Slot metadata carries the
+ * captured sequence numbers (gaps in the capture reappear as gaps) and the
+ * captured packet lengths; timestamps are the replay's own commit times so
+ * the latency telemetry measures the build under test.
+ */
+class audio_replay_producer : public iaudio_producer {
+private:
+    audio_rb_controller* buffer_controller;
+    audio_capture_reader* reader;           // Not owned; must outlive streaming
+    audio_replay_config config;
+    std::atomic<bool> running;
+    std::atomic<bool> finished;
+    std::thread producer_thread;
+    int lane;                               // Controller lane this producer owns (-1 = none)
+    std::atomic<uint32_t> total_frames_produced;
+    std::atomic<uint32_t> truncated_packets;  // Captured packets larger than the ring slot
+    std::atomic<uint64_t> page_fault_count;
+    std::atomic<uint64_t> loops_completed;
+    std::atomic<uint64_t> backpressure_waits;
+    std::atomic<uint64_t> wakeup_count;
+    std::atomic<uint64_t> wake_latency_total_ns;
+    std::atomic<uint64_t> wake_latency_max_ns;
+    audio_thread_policy thread_policy;
+    audio_thread_policy_result thread_result;
+    mutable std::mutex thread_result_lock;  // thread_result is written by producer_thread
+
+    void producerLoop();
+    bool nextRecord(audio_capture_record* pRecord);   // Next record on the replayed lane, looping if configured
+    void waitForSpace(audio_frame_ring* ring, size_t frames);
+
+public:
+    audio_replay_producer(audio_rb_controller* controller, audio_capture_reader* captureReader,
+                          const audio_replay_config& replayConfig = audio_replay_config());
+    ~audio_replay_producer();
+
+    void start() override;
+    void stop() override;
+    bool isRunning() const override;
+    uint32_t getTotalFramesProduced() const override;
+    uint32_t getOverrunCount() const override;
+    uint64_t getPageFaultCount() const override;
+    uint64_t getLoopAllocationCount() const override;
+    audio_wait_stats getWaitStats() const override;
+    audio_pacing_stats getPacingStats() const override;
+    void setSource(iaudio_source* source) override;
+    iaudio_source* getSource() const override;
+    void setThreadPolicy(const audio_thread_policy& policy) override;
+    audio_thread_policy_result getThreadPolicyResult() const override;
+
+    // True once a non-looping replay has committed its last microframe
+    bool isFinished() const;
+    uint64_t getLoopsCompleted() const;
+};
+
+} // namespace kcobain
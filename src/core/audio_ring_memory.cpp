@@ -0,0 +1,368 @@
+#include "audio_ring_memory.h"
+#include "../../include/kcobain/logger.h"
+#include "../../external/miniaudio.h"
+
+#if defined(__linux__)
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_LINUX_VM
+#endif
+
+#ifndef KCOBAIN_CACHE_LINE_SIZE
+    #define KCOBAIN_CACHE_LINE_SIZE 64
+#endif
+
+namespace kcobain {
+
+namespace {
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+size_t gcd(size_t a, size_t b) {
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+#ifdef KCOBAIN_HAS_LINUX_VM
+int createMemfd(const char* name) {
+    // Raw syscall so older glibc and bionic without the wrapper still work
+    return static_cast<int>(syscall(SYS_memfd_create, name, 0));
+}
+#endif
+
+} // namespace
+
+audio_ring_memory::audio_ring_memory()
+    : base(nullptr), size_bytes(0), mapping_bytes(0), backing(audio_rb_backing::heap),
+      mapped(false), huge_pages(false), locked(false), shared(false) {
+}
+
+audio_ring_memory::~audio_ring_memory() {
+    release();
+}
+
+bool audio_ring_memory::allocate(size_t sizeBytes, audio_rb_backing backingMode,
+                                 const audio_ring_memory_options& options) {
+    release();
+
+    if (sizeBytes == 0) {
+        LOG_ERROR("Cannot allocate empty ring memory");
+        return false;
+    }
+
+    bool allocated = false;
+    if (backingMode == audio_rb_backing::mirrored) {
+        if (options.hugePages) {
+            // Mirroring needs page-granular halves; 2 MB granularity would blow up the ring size
+            LOG_WARN("Huge pages are not used for mirrored ring memory");
+        }
+        allocated = allocateMirrored(sizeBytes);
+        if (!allocated) {
+            LOG_WARN("Mirrored ring memory unavailable, falling back to heap");
+        }
+    }
+
+    if (!allocated && !allocateHeap(sizeBytes, options.hugePages)) {
+        return false;
+    }
+
+    applyOptions(options);
+    return true;
+}
+
+bool audio_ring_memory::allocateHeap(size_t sizeBytes, bool hugePages) {
+#ifdef KCOBAIN_HAS_LINUX_VM
+    if (hugePages) {
+        // Explicit huge pages first, then a normal mapping the kernel may back with THP
+        size_t hugeBytes = ((sizeBytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+        void* p = mmap(NULL, hugeBytes, PROT_READ | PROT_WRITE, 
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            base = p;
+            mapping_bytes = hugeBytes;
+            huge_pages = true;
+        } else {
+            p = mmap(NULL, sizeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                LOG_ERROR("Failed to map " + std::to_string(sizeBytes) + " bytes of ring memory");
+                return false;
+            }
+            madvise(p, sizeBytes, MADV_HUGEPAGE);
+            LOG_WARN("No explicit huge pages available, using transparent huge page hint");
+            base = p;
+            mapping_bytes = sizeBytes;
+        }
+        size_bytes = sizeBytes;
+        backing = audio_rb_backing::heap;
+        mapped = true;
+        return true;
+    }
+#else
+    if (hugePages) {
+        LOG_WARN("Huge pages are not supported on this platform");
+    }
+#endif
+
+    base = ma_aligned_malloc(sizeBytes, KCOBAIN_CACHE_LINE_SIZE, NULL);
+    if (!base) {
+        LOG_ERROR("Failed to allocate " + std::to_string(sizeBytes) + " bytes of ring memory");
+        return false;
+    }
+
+    size_bytes = sizeBytes;
+    mapping_bytes = sizeBytes;
+    backing = audio_rb_backing::heap;
+    return true;
+}
+
+bool audio_ring_memory::allocateMirrored(size_t sizeBytes) {
+#ifdef KCOBAIN_HAS_LINUX_VM
+    if (sizeBytes % getPageSize() != 0) {
+        LOG_ERROR("Mirrored ring size must be a multiple of the page size (" + 
+                  std::to_string(getPageSize()) + " bytes)");
+        return false;
+    }
+
+    int fd = createMemfd("kcobain_ring");
+    if (fd < 0) {
+        LOG_ERROR("memfd_create failed for mirrored ring");
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(sizeBytes)) != 0) {
+        LOG_ERROR("ftruncate failed for mirrored ring");
+        close(fd);
+        return false;
+    }
+
+    // The mappings keep the memfd alive
+    bool mappedOk = mapFile(fd, 0, sizeBytes, true);
+    close(fd);
+    return mappedOk;
+#else
+    (void)sizeBytes;
+    return false;
+#endif
+}
+
+bool audio_ring_memory::mapShared(int fd, size_t offset, size_t sizeBytes, bool mirror,
+                                  const audio_ring_memory_options& options) {
+    release();
+
+    if (fd < 0 || sizeBytes == 0) {
+        LOG_ERROR("Cannot map shared ring memory - invalid segment");
+        return false;
+    }
+    if (options.hugePages) {
+        LOG_WARN("Huge pages are not used for shared ring memory");
+    }
+
+    if (!mapFile(fd, offset, sizeBytes, mirror)) {
+        return false;
+    }
+    shared = true;
+    applyOptions(options);
+    return true;
+}
+
+bool audio_ring_memory::mapFile(int fd, size_t offset, size_t sizeBytes, bool mirror) {
+#ifdef KCOBAIN_HAS_LINUX_VM
+    if (offset % getPageSize() != 0 || (mirror && sizeBytes % getPageSize() != 0)) {
+        LOG_ERROR("Ring mapping must be page aligned (" + std::to_string(getPageSize()) + " bytes)");
+        return false;
+    }
+
+    if (!mirror) {
+        void* p = mmap(NULL, sizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset));
+        if (p == MAP_FAILED) {
+            LOG_ERROR("Failed to map " + std::to_string(sizeBytes) + " bytes of ring memory");
+            return false;
+        }
+        base = p;
+        size_bytes = sizeBytes;
+        mapping_bytes = sizeBytes;
+        backing = audio_rb_backing::heap;
+        mapped = true;
+        return true;
+    }
+
+    // Reserve 2x the size, then map the same pages into both halves
+    void* reserved = mmap(NULL, sizeBytes * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED) {
+        LOG_ERROR("Failed to reserve address space for mirrored ring");
+        return false;
+    }
+
+    uint8_t* first = static_cast<uint8_t*>(reserved);
+    off_t fileOffset = static_cast<off_t>(offset);
+    void* lower = mmap(first, sizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, fileOffset);
+    void* upper = mmap(first + sizeBytes, sizeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, fileOffset);
+
+    if (lower != first || upper != first + sizeBytes) {
+        LOG_ERROR("Failed to map mirrored ring halves");
+        munmap(reserved, sizeBytes * 2);
+        return false;
+    }
+
+    base = reserved;
+    size_bytes = sizeBytes;
+    mapping_bytes = sizeBytes * 2;
+    backing = audio_rb_backing::mirrored;
+    mapped = true;
+    return true;
+#else
+    (void)fd; (void)offset; (void)sizeBytes; (void)mirror;
+    LOG_ERROR("File-backed ring memory is not supported on this platform");
+    return false;
+#endif
+}
+
+void audio_ring_memory::applyOptions(const audio_ring_memory_options& options) {
+#ifdef KCOBAIN_HAS_LINUX_VM
+    if (options.lockPages) {
+        if (mlock(base, mapping_bytes) == 0) {
+            locked = true;
+        } else {
+            LOG_WARN("mlock failed for ring memory (check RLIMIT_MEMLOCK), pages may be swapped");
+        }
+    }
+#else
+    if (options.lockPages) {
+        LOG_WARN("Page locking is not supported on this platform");
+    }
+#endif
+
+    if (options.prefault) {
+        // Fault every page in once so the first producer pass never faults; the
+        // upper mirror half shares the same pages so touching one copy is enough
+        audio_page_faults before = getThreadPageFaults();
+        size_t stride = huge_pages ? HUGE_PAGE_SIZE : getPageSize();
+        if (!shared) {
+            // Private memory we own: a write touch also breaks copy-on-write
+            volatile uint8_t* bytes = static_cast<volatile uint8_t*>(base);
+            for (size_t offset = 0; offset < size_bytes; offset += stride) {
+                bytes[offset] = 0;
+            }
+            if (size_bytes > 0) {
+                bytes[size_bytes - 1] = 0;
+            }
+        } else if (!populateWritable()) {
+            // A shared segment may already hold committed microframes (and a live producer
+            // writing more): populate without storing, or fall back to a read touch
+            volatile const uint8_t* bytes = static_cast<volatile const uint8_t*>(base);
+            uint8_t sink = 0;
+            for (size_t offset = 0; offset < size_bytes; offset += stride) {
+                sink ^= bytes[offset];
+            }
+            if (size_bytes > 0) {
+                sink ^= bytes[size_bytes - 1];
+            }
+            (void)sink;
+        }
+        audio_page_faults after = getThreadPageFaults();
+        prefault_faults.minor = after.minor - before.minor;
+        prefault_faults.major = after.major - before.major;
+    }
+}
+
+bool audio_ring_memory::populateWritable() {
+#if defined(KCOBAIN_HAS_LINUX_VM) && defined(MADV_POPULATE_WRITE)
+    // Linux 5.14+: writable page table entries without touching the contents
+    return madvise(base, size_bytes, MADV_POPULATE_WRITE) == 0;
+#else
+    return false;
+#endif
+}
+
+void audio_ring_memory::release() {
+    if (!base) return;
+
+    if (mapped) {
+#ifdef KCOBAIN_HAS_LINUX_VM
+        if (locked) {
+            munlock(base, mapping_bytes);
+        }
+        munmap(base, mapping_bytes);
+#endif
+    } else {
+        ma_aligned_free(base, NULL);
+    }
+
+    base = nullptr;
+    size_bytes = 0;
+    mapping_bytes = 0;
+    backing = audio_rb_backing::heap;
+    mapped = false;
+    huge_pages = false;
+    locked = false;
+    shared = false;
+    prefault_faults = audio_page_faults();
+}
+
+void* audio_ring_memory::getData() const {
+    return base;
+}
+
+size_t audio_ring_memory::getSize() const {
+    return size_bytes;
+}
+
+audio_rb_backing audio_ring_memory::getBacking() const {
+    return backing;
+}
+
+bool audio_ring_memory::isMirrored() const {
+    return base != nullptr && backing == audio_rb_backing::mirrored;
+}
+
+bool audio_ring_memory::usesHugePages() const {
+    return huge_pages;
+}
+
+bool audio_ring_memory::isLocked() const {
+    return locked;
+}
+
+bool audio_ring_memory::isShared() const {
+    return shared;
+}
+
+audio_page_faults audio_ring_memory::getPrefaultFaults() const {
+    return prefault_faults;
+}
+
+size_t audio_ring_memory::getPageSize() {
+#ifdef KCOBAIN_HAS_LINUX_VM
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize > 0 ? static_cast<size_t>(pageSize) : 4096;
+#else
+    return 4096;
+#endif
+}
+
+size_t audio_ring_memory::getMirrorGranularity(size_t frameSize) {
+    // Smallest frame count whose byte size is a whole number of pages
+    // (32 microframes for 384-byte frames on 4 KiB pages)
+    size_t pageSize = getPageSize();
+    return pageSize / gcd(pageSize, frameSize);
+}
+
+audio_page_faults audio_ring_memory::getThreadPageFaults() {
+    audio_page_faults faults;
+#if defined(KCOBAIN_HAS_LINUX_VM) && defined(RUSAGE_THREAD)
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+        faults.minor = static_cast<uint64_t>(usage.ru_minflt);
+        faults.major = static_cast<uint64_t>(usage.ru_majflt);
+    }
+#endif
+    return faults;
+}
+
+} // namespace kcobain
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kcobain {
+
+/**
+ * @brief Ring buffer backing modes
+ */
+enum class audio_rb_backing {
+    heap,       // Cache-line aligned heap block (anonymous mapping when paging options are set)
+    mirrored    // memfd mapped twice back to back; acquires never split at the wrap
+};
+
+/**
+ * @brief Paging options for ring memory
+ */
+struct audio_ring_memory_options {
+    bool hugePages;     // Try 2 MB huge pages (MAP_HUGETLB, then transparent huge pages)
+    bool lockPages;     // mlock the pages so they cannot be swapped out
+    bool prefault;      // Touch every page before streaming starts (read-only on shared segments)
+    
+    audio_ring_memory_options() : hugePages(false), lockPages(false), prefault(false) {}
+};
+
+/**
+ * @brief Page fault counters (from getrusage)
+ */
+struct audio_page_faults {
+    uint64_t minor;
+    uint64_t major;
+    
+    audio_page_faults() : minor(0), major(0) {}
+};
+
+/**
+ * @brief Ring Buffer Memory
+ * Owns the slot storage behind an audio_frame_ring
+ */
+class audio_ring_memory {
+private:
+    void* base;                 // Start of the data region
+    size_t size_bytes;          // Size of one copy of the data region
+    size_t mapping_bytes;       // Total reserved virtual range (2x when mirrored)
+    audio_rb_backing backing;
+    bool mapped;                // Data region came from mmap rather than the heap
+    bool huge_pages;            // Backed by explicit huge pages
+    bool locked;                // mlock succeeded
+    bool shared;                // Mapped from a shared segment owned by someone else
+    audio_page_faults prefault_faults;
+
+    bool allocateHeap(size_t sizeBytes, bool hugePages);
+    bool allocateMirrored(size_t sizeBytes);
+    bool mapFile(int fd, size_t offset, size_t sizeBytes, bool mirror);
+    void applyOptions(const audio_ring_memory_options& options);
+    bool populateWritable();    // Prefault a shared mapping without storing to it
+
+public:
+    audio_ring_memory();
+    ~audio_ring_memory();
+
+    bool allocate(size_t sizeBytes, audio_rb_backing backingMode,
+                  const audio_ring_memory_options& options = audio_ring_memory_options());
+    bool mapShared(int fd, size_t offset, size_t sizeBytes, bool mirror,
+                   const audio_ring_memory_options& options = audio_ring_memory_options());
+    void release();
+
+    void* getData() const;
+    size_t getSize() const;
+    audio_rb_backing getBacking() const;
+    bool isMirrored() const;
+    bool usesHugePages() const;
+    bool isLocked() const;
+    bool isShared() const;
+    audio_page_faults getPrefaultFaults() const;
+
+    static size_t getPageSize();
+    static size_t getMirrorGranularity(size_t frameSize);
+    static audio_page_faults getThreadPageFaults();
+};
+
+} // namespace kcobain
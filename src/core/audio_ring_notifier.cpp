@@ -0,0 +1,128 @@
+#include "audio_ring_notifier.h"
+#include "../../include/kcobain/logger.h"
+
+#if defined(__linux__)
+    #include <sys/eventfd.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_EVENTFD
+#endif
+
+namespace kcobain {
+
+audio_ring_notifier::audio_ring_notifier()
+    : readable_fd(-1), writable_fd(-1), read_threshold(1), write_threshold(1), read_armed(0), write_armed(0) {
+}
+
+audio_ring_notifier::~audio_ring_notifier() {
+    release();
+}
+
+bool audio_ring_notifier::initialize(size_t readThresholdFrames, size_t writeThresholdFrames) {
+#ifdef KCOBAIN_HAS_EVENTFD
+    release();
+
+    // Non-blocking so a drain never stalls the event loop
+    readable_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    writable_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (readable_fd < 0 || writable_fd < 0) {
+        LOG_ERROR("Failed to create ring readiness eventfds");
+        release();
+        return false;
+    }
+
+    read_threshold = readThresholdFrames > 0 ? readThresholdFrames : 1;
+    write_threshold = writeThresholdFrames > 0 ? writeThresholdFrames : 1;
+    return true;
+#else
+    (void)readThresholdFrames;
+    (void)writeThresholdFrames;
+    LOG_ERROR("Ring readiness eventfds are not supported on this platform");
+    return false;
+#endif
+}
+
+void audio_ring_notifier::release() {
+#ifdef KCOBAIN_HAS_EVENTFD
+    if (readable_fd >= 0) close(readable_fd);
+    if (writable_fd >= 0) close(writable_fd);
+#endif
+    readable_fd = -1;
+    writable_fd = -1;
+    read_armed.store(0, std::memory_order_relaxed);
+    write_armed.store(0, std::memory_order_relaxed);
+}
+
+bool audio_ring_notifier::isInitialized() const {
+    return readable_fd >= 0 && writable_fd >= 0;
+}
+
+int audio_ring_notifier::getReadableFd() const {
+    return readable_fd;
+}
+
+int audio_ring_notifier::getWritableFd() const {
+    return writable_fd;
+}
+
+size_t audio_ring_notifier::getReadThreshold() const {
+    return read_threshold;
+}
+
+size_t audio_ring_notifier::getWriteThreshold() const {
+    return write_threshold;
+}
+
+void audio_ring_notifier::armReadable() {
+    // seq_cst pairs with the committing side's fence: either it sees the arm
+    // or the waiter's re-check sees its commit
+    read_armed.store(1, std::memory_order_seq_cst);
+}
+
+void audio_ring_notifier::armWritable() {
+    write_armed.store(1, std::memory_order_seq_cst);
+}
+
+void audio_ring_notifier::disarmReadable() {
+    read_armed.store(0, std::memory_order_relaxed);
+}
+
+void audio_ring_notifier::disarmWritable() {
+    write_armed.store(0, std::memory_order_relaxed);
+}
+
+void audio_ring_notifier::onFramesReady(size_t framesReady) {
+    if (read_armed.load(std::memory_order_relaxed) == 0 || framesReady < read_threshold) return;
+    // Exchange so a single arm never produces two wake-ups
+    if (read_armed.exchange(0, std::memory_order_acq_rel) != 0) {
+        signal(readable_fd);
+    }
+}
+
+void audio_ring_notifier::onFramesFree(size_t framesFree) {
+    if (write_armed.load(std::memory_order_relaxed) == 0 || framesFree < write_threshold) return;
+    if (write_armed.exchange(0, std::memory_order_acq_rel) != 0) {
+        signal(writable_fd);
+    }
+}
+
+void audio_ring_notifier::signal(int fd) {
+#ifdef KCOBAIN_HAS_EVENTFD
+    uint64_t one = 1;
+    ssize_t written = write(fd, &one, sizeof(one));
+    (void)written;
+#else
+    (void)fd;
+#endif
+}
+
+void audio_ring_notifier::drain(int fd) {
+#ifdef KCOBAIN_HAS_EVENTFD
+    uint64_t count = 0;
+    ssize_t bytesRead = read(fd, &count, sizeof(count));
+    (void)bytesRead;
+#else
+    (void)fd;
+#endif
+}
+
+} // namespace kcobain
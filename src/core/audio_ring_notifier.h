@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Cache line size used to keep producer and consumer state apart
+#ifndef KCOBAIN_CACHE_LINE_SIZE
+    #define KCOBAIN_CACHE_LINE_SIZE 64
+#endif
+
+namespace kcobain {
+
+/**
+ * @brief Readiness notifications for an event loop
+ * Two eventfds: readable fires once at least the read threshold of
+ * microframes is buffered, writable once at least the write threshold is
+ * free. A side arms its fd before sleeping in epoll; the opposite side's
+ * commit only pays for a relaxed load until then, and each arm produces at
+ * most one eventfd write.
+ */
+class audio_ring_notifier {
+private:
+    int readable_fd;
+    int writable_fd;
+    size_t read_threshold;       // Microframes buffered before readable fires
+    size_t write_threshold;      // Microframes free before writable fires
+    // Padded rather than alignas: the notifier is heap allocated and C++11 new
+    // does not honour extended alignment
+    char pad_read[KCOBAIN_CACHE_LINE_SIZE];
+    std::atomic<uint32_t> read_armed;     // Consumer is waiting for data
+    char pad_write[KCOBAIN_CACHE_LINE_SIZE];
+    std::atomic<uint32_t> write_armed;    // Producer is waiting for space
+    char pad_end[KCOBAIN_CACHE_LINE_SIZE];
+
+    static void signal(int fd);
+
+public:
+    audio_ring_notifier();
+    ~audio_ring_notifier();
+
+    bool initialize(size_t readThresholdFrames, size_t writeThresholdFrames);
+    void release();
+    bool isInitialized() const;
+
+    int getReadableFd() const;
+    int getWritableFd() const;
+    size_t getReadThreshold() const;
+    size_t getWriteThreshold() const;
+
+    // Waiting side: arm, then re-check the ring before sleeping (see audio_rb_controller::armReadable)
+    void armReadable();
+    void armWritable();
+    void disarmReadable();
+    void disarmWritable();
+
+    // Committing side, after the position store and a seq_cst fence
+    void onFramesReady(size_t framesReady);
+    void onFramesFree(size_t framesFree);
+
+    // Clear a fired eventfd after epoll reports it
+    static void drain(int fd);
+};
+
+} // namespace kcobain
@@ -0,0 +1,275 @@
+#include "audio_sample_format.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define KCOBAIN_CONVERT_SSE2
+    #if defined(__SSSE3__)
+        #include <tmmintrin.h>
+        #define KCOBAIN_CONVERT_SSSE3
+    #endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define KCOBAIN_CONVERT_NEON
+#endif
+
+namespace kcobain {
+
+namespace {
+
+// Quantizer for one format: scale to the valid bits, clamp, then shift into the subslot
+struct quantizer {
+    float scale;
+    float minValue;
+    float maxValue;     // Largest float that still fits; 2^31 - 1 is not representable
+    int shift;          // Left shift that MSB-aligns the valid bits in the subslot
+
+    explicit quantizer(const audio_microframe_format& format) {
+        int bits = format.bitResolution;
+        scale = std::ldexp(1.0f, bits - 1);
+        minValue = -scale;
+        maxValue = bits > 24 ? std::nextafter(scale, 0.0f) : scale - 1.0f;
+        shift = format.subslotBytes * 8 - bits;
+    }
+
+    int32_t operator()(float sample) const {
+        float value = sample * scale;
+        // Written so NaN fails the first test, as with the SIMD max/min below
+        if (!(value >= minValue)) value = minValue;
+        if (value > maxValue) value = maxValue;
+        return static_cast<int32_t>(static_cast<uint32_t>(static_cast<int32_t>(std::lrint(value))) << shift);
+    }
+};
+
+void storeSample(uint8_t* pOut, int32_t value, size_t subslotBytes) {
+    if (subslotBytes == 2) {
+        int16_t sample = static_cast<int16_t>(value);
+        std::memcpy(pOut, &sample, sizeof(sample));
+    } else if (subslotBytes == 3) {
+        uint32_t bits = static_cast<uint32_t>(value);
+        pOut[0] = static_cast<uint8_t>(bits);
+        pOut[1] = static_cast<uint8_t>(bits >> 8);
+        pOut[2] = static_cast<uint8_t>(bits >> 16);
+    } else {
+        std::memcpy(pOut, &value, sizeof(value));
+    }
+}
+
+void convertScalar(const float* pIn, uint8_t* pOut, size_t sampleCount, const quantizer& q, size_t subslotBytes) {
+    for (size_t i = 0; i < sampleCount; ++i) {
+        storeSample(pOut + i * subslotBytes, q(pIn[i]), subslotBytes);
+    }
+}
+
+// Vector kernels handle the bulk in groups; every kernel returns how many
+// samples it converted and the scalar path finishes the tail
+
+#if defined(KCOBAIN_CONVERT_SSE2)
+
+inline __m128i quantize4(const float* pIn, __m128 scale, __m128 minValue, __m128 maxValue, __m128i shift) {
+    __m128 value = _mm_mul_ps(_mm_loadu_ps(pIn), scale);
+    value = _mm_max_ps(value, minValue);    // NaN → minValue (maxps returns the second operand)
+    value = _mm_min_ps(value, maxValue);
+    return _mm_sll_epi32(_mm_cvtps_epi32(value), shift);    // Round to nearest (default MXCSR)
+}
+
+size_t convertVector(const float* pIn, uint8_t* pOut, size_t sampleCount, const quantizer& q, size_t subslotBytes) {
+    const __m128 scale = _mm_set1_ps(q.scale);
+    const __m128 minValue = _mm_set1_ps(q.minValue);
+    const __m128 maxValue = _mm_set1_ps(q.maxValue);
+    const __m128i shift = _mm_cvtsi32_si128(q.shift);
+    size_t i = 0;
+
+    if (subslotBytes == 4) {
+        for (; i + 4 <= sampleCount; i += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i * 4), quantize4(pIn + i, scale, minValue, maxValue, shift));
+        }
+    } else if (subslotBytes == 2) {
+        // Values already fit 16 bits, so the saturating pack is exact
+        for (; i + 8 <= sampleCount; i += 8) {
+            __m128i lo = quantize4(pIn + i, scale, minValue, maxValue, shift);
+            __m128i hi = quantize4(pIn + i + 4, scale, minValue, maxValue, shift);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i * 2), _mm_packs_epi32(lo, hi));
+        }
+    } else {
+#if defined(KCOBAIN_CONVERT_SSSE3)
+        // Drop the top byte of each lane; the 16-byte store overlaps the next
+        // group by 4 bytes, so stop while 16 bytes are still in bounds (same below)
+        const __m128i pack24 = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        for (; i + 8 <= sampleCount; i += 4) {
+            __m128i packed = _mm_shuffle_epi8(quantize4(pIn + i, scale, minValue, maxValue, shift), pack24);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i * 3), packed);
+        }
+#else
+        // No byte shuffle in SSE2: close the gap inside each 64-bit half
+        // (s0 | s1 << 24), then slide the upper 6 bytes down against the lower 6
+        const __m128i low24 = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+        const __m128i high24 = _mm_set_epi32(0x0000FFFF, static_cast<int>(0xFF000000u), 0x0000FFFF, static_cast<int>(0xFF000000u));
+        const __m128i lowHalf = _mm_set_epi32(0, 0, -1, -1);
+        const __m128i highHalf = _mm_set_epi32(-1, -1, 0, 0);
+        for (; i + 8 <= sampleCount; i += 4) {
+            __m128i samples = quantize4(pIn + i, scale, minValue, maxValue, shift);
+            __m128i pairs = _mm_or_si128(_mm_and_si128(samples, low24), _mm_and_si128(_mm_srli_epi64(samples, 8), high24));
+            __m128i packed = _mm_or_si128(_mm_and_si128(pairs, lowHalf), _mm_srli_si128(_mm_and_si128(pairs, highHalf), 2));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i * 3), packed);
+        }
+#endif
+    }
+    return i;
+}
+
+#elif defined(KCOBAIN_CONVERT_NEON)
+
+inline int32x4_t quantize4(const float* pIn, float32x4_t scale, float32x4_t minValue, float32x4_t maxValue, int32x4_t shift) {
+    float32x4_t value = vmulq_f32(vld1q_f32(pIn), scale);
+    value = vmaxnmq_f32(value, minValue);   // NaN → minValue
+    value = vminq_f32(value, maxValue);
+    return vshlq_s32(vcvtnq_s32_f32(value), shift);    // Round to nearest
+}
+
+size_t convertVector(const float* pIn, uint8_t* pOut, size_t sampleCount, const quantizer& q, size_t subslotBytes) {
+    const float32x4_t scale = vdupq_n_f32(q.scale);
+    const float32x4_t minValue = vdupq_n_f32(q.minValue);
+    const float32x4_t maxValue = vdupq_n_f32(q.maxValue);
+    const int32x4_t shift = vdupq_n_s32(q.shift);
+    size_t i = 0;
+
+    if (subslotBytes == 4) {
+        for (; i + 4 <= sampleCount; i += 4) {
+            vst1q_s32(reinterpret_cast<int32_t*>(pOut + i * 4), quantize4(pIn + i, scale, minValue, maxValue, shift));
+        }
+    } else if (subslotBytes == 2) {
+        for (; i + 8 <= sampleCount; i += 8) {
+            int16x8_t packed = vcombine_s16(vqmovn_s32(quantize4(pIn + i, scale, minValue, maxValue, shift)),
+                                            vqmovn_s32(quantize4(pIn + i + 4, scale, minValue, maxValue, shift)));
+            vst1q_s16(reinterpret_cast<int16_t*>(pOut + i * 2), packed);
+        }
+    } else {
+        // Same overlapping 16-byte store as the SSSE3 path
+        static const uint8_t PACK24[16] = {0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 16, 16, 16, 16};
+        const uint8x16_t pack24 = vld1q_u8(PACK24);
+        for (; i + 8 <= sampleCount; i += 4) {
+            uint8x16_t bytes = vreinterpretq_u8_s32(quantize4(pIn + i, scale, minValue, maxValue, shift));
+            vst1q_u8(pOut + i * 3, vqtbl1q_u8(bytes, pack24));
+        }
+    }
+    return i;
+}
+
+#else
+
+size_t convertVector(const float*, uint8_t*, size_t, const quantizer&, size_t) {
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+audio_microframe_format audio_microframe_format::pcm(uint32_t rate, uint16_t channelCount, uint8_t subslot, uint8_t bits) {
+    audio_microframe_format format;
+    format.sampleRate = rate;
+    format.channels = channelCount;
+    format.subslotBytes = subslot;
+    format.bitResolution = bits;
+    format.encoding = audio_sample_encoding::pcm;
+    return format;
+}
+
+audio_microframe_format audio_microframe_format::float32(uint32_t rate, uint16_t channelCount) {
+    audio_microframe_format format;
+    format.sampleRate = rate;
+    format.channels = channelCount;
+    return format;
+}
+
+bool audio_microframe_format::isValid() const {
+    if (sampleRate == 0 || channels == 0 || microframesPerSecond == 0) return false;
+    if (encoding == audio_sample_encoding::ieee_float) {
+        return subslotBytes == 4 && bitResolution == 32;
+    }
+    return subslotBytes >= 2 && subslotBytes <= 4 && bitResolution >= 8 && bitResolution <= subslotBytes * 8;
+}
+
+bool audio_microframe_format::isFloat() const {
+    return encoding == audio_sample_encoding::ieee_float;
+}
+
+bool audio_microframe_format::hasSameSamples(const audio_microframe_format& other) const {
+    return sampleRate == other.sampleRate && channels == other.channels && subslotBytes == other.subslotBytes &&
+           bitResolution == other.bitResolution && encoding == other.encoding;
+}
+
+size_t audio_microframe_format::getBytesPerFrame() const {
+    return static_cast<size_t>(channels) * subslotBytes;
+}
+
+size_t audio_microframe_format::getFramesPerMicroframe() const {
+    if (microframesPerSecond == 0) return 0;
+    return (static_cast<size_t>(sampleRate) + microframesPerSecond - 1) / microframesPerSecond;
+}
+
+size_t audio_microframe_format::getSamplesPerMicroframe() const {
+    return getFramesPerMicroframe() * channels;
+}
+
+size_t audio_microframe_format::getPayloadBytes() const {
+    return getFramesPerMicroframe() * getBytesPerFrame();
+}
+
+std::string audio_microframe_format::describe() const {
+    std::string sample = isFloat() ? std::string("f32")
+                                   : "s" + std::to_string(bitResolution) + "/" + std::to_string(subslotBytes * 8);
+    return std::to_string(sampleRate) + " Hz, " + std::to_string(channels) + " ch, " + sample;
+}
+
+void audio_convert_from_float(const float* pIn, void* pOut, size_t sampleCount, const audio_microframe_format& format) {
+    uint8_t* pBytes = static_cast<uint8_t*>(pOut);
+    if (format.isFloat()) {
+        std::memcpy(pBytes, pIn, sampleCount * sizeof(float));
+        return;
+    }
+
+    quantizer q(format);
+    size_t converted = convertVector(pIn, pBytes, sampleCount, q, format.subslotBytes);
+    convertScalar(pIn + converted, pBytes + converted * format.subslotBytes, sampleCount - converted, q, format.subslotBytes);
+}
+
+void audio_convert_to_float(const void* pIn, float* pOut, size_t sampleCount, const audio_microframe_format& format) {
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pIn);
+    if (format.isFloat()) {
+        std::memcpy(pOut, pBytes, sampleCount * sizeof(float));
+        return;
+    }
+
+    // Left-align in 32 bits so every subslot width shares one scale
+    const float scale = 1.0f / 2147483648.0f;
+    for (size_t i = 0; i < sampleCount; ++i) {
+        const uint8_t* p = pBytes + i * format.subslotBytes;
+        uint32_t bits = 0;
+        if (format.subslotBytes == 2) {
+            bits = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 24);
+        } else if (format.subslotBytes == 3) {
+            bits = (static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 24);
+        } else {
+            bits = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+                   (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+        pOut[i] = static_cast<float>(static_cast<int32_t>(bits)) * scale;
+    }
+}
+
+const char* audio_convert_simd_name() {
+#if defined(KCOBAIN_CONVERT_SSSE3)
+    return "SSSE3";
+#elif defined(KCOBAIN_CONVERT_SSE2)
+    return "SSE2";
+#elif defined(KCOBAIN_CONVERT_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace kcobain
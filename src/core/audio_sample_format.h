@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace kcobain {
+
+/**
+ * @brief How samples are encoded in a subslot
+ */
+enum class audio_sample_encoding {
+    pcm,            // Two's complement integer, little endian
+    ieee_float      // 32-bit float
+};
+
+/**
+ * @brief Wire format of the audio payload in a microframe
+ * Follows UAC2 terms: each sample occupies a subslot of subslotBytes, and
+ * the bitResolution valid bits are MSB-aligned in it (24-in-32 leaves the
+ * low byte zero). Rates that are not a multiple of the microframe rate
+ * round up here, giving the largest packet; audio_packet_scheduler
+ * produces the actual packet sequence.
+ */
+struct audio_microframe_format {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint8_t subslotBytes;           // 2, 3 (packed s24) or 4
+    uint8_t bitResolution;          // Valid bits per sample, <= subslotBytes * 8
+    audio_sample_encoding encoding;
+    uint32_t microframesPerSecond;  // 8000 for high speed, 1000 for full speed
+    
+    audio_microframe_format()
+        : sampleRate(96000), channels(2), subslotBytes(4), bitResolution(32), encoding(audio_sample_encoding::ieee_float),
+          microframesPerSecond(8000) {}
+    
+    static audio_microframe_format pcm(uint32_t rate, uint16_t channelCount, uint8_t subslot, uint8_t bits);
+    static audio_microframe_format float32(uint32_t rate, uint16_t channelCount);
+    
+    bool isValid() const;
+    bool isFloat() const;
+    bool hasSameSamples(const audio_microframe_format& other) const;   // Rate, channels and sample encoding
+    size_t getBytesPerFrame() const;            // One sample frame, all channels
+    size_t getFramesPerMicroframe() const;      // Largest packet
+    size_t getSamplesPerMicroframe() const;
+    size_t getPayloadBytes() const;             // Packed payload of one microframe
+    std::string describe() const;               // e.g. "96000 Hz, 2 ch, s24/32"
+};
+
+// Float [-1, 1] → wire format. Out-of-range input clips, NaN becomes
+// negative full scale; rounding is to nearest. pOut need not be aligned.
+void audio_convert_from_float(const float* pIn, void* pOut, size_t sampleCount, const audio_microframe_format& format);
+
+// Wire format → float, for the consumer side (scalar)
+void audio_convert_to_float(const void* pIn, float* pOut, size_t sampleCount, const audio_microframe_format& format);
+
+// Instruction set the converters were built for ("SSE2", "SSSE3", "NEON" or "scalar")
+const char* audio_convert_simd_name();
+
+} // namespace kcobain
@@ -0,0 +1,307 @@
+#include "audio_shm_segment.h"
+#include "audio_ring_memory.h"
+#include "../../include/kcobain/logger.h"
+#include <new>
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <signal.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_POSIX_SHM
+#endif
+
+namespace kcobain {
+
+audio_shm_segment::audio_shm_segment()
+    : fd(-1), header(nullptr), header_bytes(0), role(audio_shm_role::producer) {
+}
+
+audio_shm_segment::~audio_shm_segment() {
+    detach();
+}
+
+size_t audio_shm_segment::headerMappingBytes() {
+    size_t pageSize = audio_ring_memory::getPageSize();
+    return ((sizeof(audio_shm_header) + pageSize - 1) / pageSize) * pageSize;
+}
+
+bool audio_shm_segment::mapHeader(size_t bytes) {
+#ifdef KCOBAIN_HAS_POSIX_SHM
+    if (header) {
+        munmap(header, header_bytes);
+        header = nullptr;
+    }
+    void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        LOG_ERROR("Failed to map shared ring header for " + name);
+        header_bytes = 0;
+        return false;
+    }
+    header = static_cast<audio_shm_header*>(p);
+    header_bytes = bytes;
+    return true;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+bool audio_shm_segment::reclaimStale(const std::string& segmentName, int64_t staleAfterNs) {
+#ifdef KCOBAIN_HAS_POSIX_SHM
+    int staleFd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    if (staleFd < 0) {
+        // Unlinked in the meantime: the name is free again
+        return errno == ENOENT;
+    }
+    struct stat info;
+    void* p = MAP_FAILED;
+    if (fstat(staleFd, &info) == 0 && static_cast<size_t>(info.st_size) >= headerMappingBytes()) {
+        p = mmap(NULL, headerMappingBytes(), PROT_READ, MAP_SHARED, staleFd, 0);
+    }
+    close(staleFd);
+    if (p == MAP_FAILED || static_cast<const audio_shm_header*>(p)->magic != audio_shm_header::MAGIC) {
+        if (p != MAP_FAILED) munmap(p, headerMappingBytes());
+        LOG_ERROR("Shared memory " + segmentName + " exists and is not a kcobain ring - remove it or pick another name");
+        return false;
+    }
+    const audio_shm_header* stale = static_cast<const audio_shm_header*>(p);
+    int32_t pid = stale->producer.pid.load(std::memory_order_acquire);
+    int64_t age = audio_steady_time_ns() - stale->producer.heartbeat_ns.load(std::memory_order_relaxed);
+    munmap(p, headerMappingBytes());
+
+    // No pid yet with a fresh heartbeat is a producer still creating the segment
+    bool ownerGone = pid == 0 ? age >= staleAfterNs : kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+    if (!ownerGone) {
+        LOG_ERROR("Shared ring segment " + segmentName + " is in use by producer process " + std::to_string(pid) +
+                  (age < staleAfterNs ? "" : " (heartbeat stale, but the process exists)"));
+        return false;
+    }
+    LOG_WARN("Reclaiming shared ring segment " + segmentName + " left behind by producer process " +
+             std::to_string(pid) + " (heartbeat " + std::to_string(age / 1000000) + " ms old)");
+    return shm_unlink(segmentName.c_str()) == 0 || errno == ENOENT;
+#else
+    (void)segmentName; (void)staleAfterNs;
+    return false;
+#endif
+}
+
+bool audio_shm_segment::create(const std::string& segmentName, size_t frameSize, size_t frameCount, bool mirrored,
+                               bool withFrameMeta, const audio_shm_format& format, int64_t staleAfterNs) {
+#ifdef KCOBAIN_HAS_POSIX_SHM
+    detach();
+
+    if (frameSize == 0 || frameCount == 0) {
+        LOG_ERROR("Cannot create shared ring - invalid geometry");
+        return false;
+    }
+
+    name = segmentName;
+    role = audio_shm_role::producer;
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST && reclaimStale(name, staleAfterNs)) {
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        LOG_ERROR("shm_open failed for " + name + " (errno " + std::to_string(errno) + ")");
+        return false;
+    }
+
+    // Header, then the metadata side channel, then the slots; each starts on a page
+    size_t pageSize = audio_ring_memory::getPageSize();
+    size_t metaOffset = withFrameMeta ? headerMappingBytes() : 0;
+    size_t metaBytes = withFrameMeta ? frameCount * sizeof(audio_frame_meta) : 0;
+    size_t dataOffset = headerMappingBytes() + ((metaBytes + pageSize - 1) / pageSize) * pageSize;
+    if (ftruncate(fd, static_cast<off_t>(dataOffset + frameSize * frameCount)) != 0 || !mapHeader(dataOffset)) {
+        LOG_ERROR("Failed to size shared ring segment " + name);
+        close(fd);
+        fd = -1;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    // Geometry first; ready is only published once the ring is usable
+    new (header) audio_shm_header();
+    header->magic = audio_shm_header::MAGIC;
+    header->version = audio_shm_header::VERSION;
+    header->frame_size = static_cast<uint32_t>(frameSize);
+    header->frame_count = frameCount;
+    header->mirrored = mirrored ? 1 : 0;
+    header->meta_offset = metaOffset;
+    header->data_offset = dataOffset;
+    header->format = format;
+    heartbeat();
+    header->producer.pid.store(static_cast<int32_t>(getpid()), std::memory_order_release);
+    return true;
+#else
+    (void)segmentName; (void)frameSize; (void)frameCount; (void)mirrored; (void)withFrameMeta; (void)format;
+    (void)staleAfterNs;
+    LOG_ERROR("Shared ring segments are not supported on this platform");
+    return false;
+#endif
+}
+
+void audio_shm_segment::markReady() {
+    if (header && role == audio_shm_role::producer) {
+        header->ready.store(1, std::memory_order_release);
+    }
+}
+
+bool audio_shm_segment::attach(const std::string& segmentName) {
+#ifdef KCOBAIN_HAS_POSIX_SHM
+    detach();
+
+    name = segmentName;
+    role = audio_shm_role::consumer;
+    fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        LOG_ERROR("No shared ring segment named " + name);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < headerMappingBytes() || 
+        !mapHeader(headerMappingBytes())) {
+        LOG_ERROR("Shared ring segment " + name + " is truncated");
+        detach();
+        return false;
+    }
+
+    if (header->magic != audio_shm_header::MAGIC || header->version != audio_shm_header::VERSION ||
+        header->ready.load(std::memory_order_acquire) == 0) {
+        LOG_ERROR("Shared ring segment " + name + " is not a ready kcobain ring");
+        detach();
+        return false;
+    }
+
+    uint64_t required = header->data_offset + static_cast<uint64_t>(header->frame_size) * header->frame_count;
+    uint64_t metaEnd = header->meta_offset + header->frame_count * sizeof(audio_frame_meta);
+    if (header->data_offset % audio_ring_memory::getPageSize() != 0 || header->data_offset < headerMappingBytes() ||
+        (header->meta_offset != 0 && metaEnd > header->data_offset) || static_cast<uint64_t>(info.st_size) < required) {
+        LOG_ERROR("Shared ring segment " + name + " has an inconsistent layout");
+        detach();
+        return false;
+    }
+    
+    // Extend the mapping over the metadata side channel
+    if (!mapHeader(static_cast<size_t>(header->data_offset))) {
+        detach();
+        return false;
+    }
+
+    if (header->consumer.pid.load(std::memory_order_acquire) != 0) {
+        LOG_WARN("Shared ring segment " + name + " already had a consumer attached, taking over");
+    }
+
+    heartbeat();
+    header->consumer.pid.store(static_cast<int32_t>(getpid()), std::memory_order_release);
+    return true;
+#else
+    (void)segmentName;
+    LOG_ERROR("Shared ring segments are not supported on this platform");
+    return false;
+#endif
+}
+
+void audio_shm_segment::detach() {
+#ifdef KCOBAIN_HAS_POSIX_SHM
+    if (header) {
+        // A clean detach lets the peer tell "gone" from "finished"
+        int32_t ownPid = static_cast<int32_t>(getpid());
+        self().pid.compare_exchange_strong(ownPid, 0, std::memory_order_acq_rel);
+        munmap(header, header_bytes);
+    }
+    if (fd >= 0) {
+        close(fd);
+        // The name goes away with the producer; open mappings stay valid
+        if (role == audio_shm_role::producer) {
+            shm_unlink(name.c_str());
+        }
+    }
+#endif
+    header = nullptr;
+    header_bytes = 0;
+    fd = -1;
+    name.clear();
+}
+
+bool audio_shm_segment::isOpen() const {
+    return header != nullptr;
+}
+
+audio_shm_peer& audio_shm_segment::self() const {
+    return role == audio_shm_role::producer ? header->producer : header->consumer;
+}
+
+audio_shm_peer& audio_shm_segment::peer() const {
+    return role == audio_shm_role::producer ? header->consumer : header->producer;
+}
+
+void audio_shm_segment::heartbeat() {
+    if (header) {
+        self().heartbeat_ns.store(audio_steady_time_ns(), std::memory_order_relaxed);
+    }
+}
+
+audio_shm_peer_state audio_shm_segment::getPeerState(int64_t staleAfterNs) const {
+    if (!header) return audio_shm_peer_state::detached;
+
+    int32_t pid = peer().pid.load(std::memory_order_acquire);
+    if (pid == 0) return audio_shm_peer_state::detached;
+
+    // Fast path: a fresh heartbeat needs no syscall (steady clock is system wide)
+    int64_t age = audio_steady_time_ns() - peer().heartbeat_ns.load(std::memory_order_relaxed);
+    if (age < staleAfterNs) return audio_shm_peer_state::alive;
+
+#ifdef KCOBAIN_HAS_POSIX_SHM
+    if (kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH) {
+        return audio_shm_peer_state::gone;
+    }
+#endif
+    return audio_shm_peer_state::stalled;
+}
+
+int audio_shm_segment::getFd() const {
+    return fd;
+}
+
+audio_shm_role audio_shm_segment::getRole() const {
+    return role;
+}
+
+const std::string& audio_shm_segment::getName() const {
+    return name;
+}
+
+size_t audio_shm_segment::getFrameSize() const {
+    return header ? header->frame_size : 0;
+}
+
+size_t audio_shm_segment::getFrameCount() const {
+    return header ? static_cast<size_t>(header->frame_count) : 0;
+}
+
+size_t audio_shm_segment::getDataOffset() const {
+    return header ? static_cast<size_t>(header->data_offset) : 0;
+}
+
+bool audio_shm_segment::isMirrored() const {
+    return header && header->mirrored != 0;
+}
+
+audio_shm_format audio_shm_segment::getFormat() const {
+    return header ? header->format : audio_shm_format();
+}
+
+audio_frame_ring_indices* audio_shm_segment::getIndices() const {
+    return header ? &header->indices : nullptr;
+}
+
+audio_frame_meta* audio_shm_segment::getFrameMeta() const {
+    if (!header || header->meta_offset == 0) return nullptr;
+    return reinterpret_cast<audio_frame_meta*>(reinterpret_cast<uint8_t*>(header) + header->meta_offset);
+}
+
+} // namespace kcobain
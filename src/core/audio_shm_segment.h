@@ -0,0 +1,135 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "audio_frame_ring.h"
+
+namespace kcobain {
+
+/**
+ * @brief Stream format recorded in a shared segment
+ * Lets the attaching process check it is reading what it expects.
+ */
+struct audio_shm_format {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bytesPerSample;
+    uint32_t audioBytesPerFrame;    // Payload bytes inside each microframe slot
+
+    audio_shm_format() : sampleRate(96000), channels(2), bytesPerSample(4), audioBytesPerFrame(96) {}
+};
+
+/**
+ * @brief Which side of the stream a process is
+ */
+enum class audio_shm_role {
+    producer,   // Creates the segment and writes microframes
+    consumer    // Attaches to an existing segment and reads microframes
+};
+
+/**
+ * @brief What one side can tell about the other process
+ */
+enum class audio_shm_peer_state {
+    alive,      // Heartbeat is fresh
+    stalled,    // Heartbeat is stale but the process still exists
+    detached,   // Peer never attached or detached cleanly
+    gone        // Peer process no longer exists
+};
+
+/**
+ * @brief Per-process liveness slot, one cache line per side
+ */
+struct audio_shm_peer {
+    alignas(KCOBAIN_CACHE_LINE_SIZE) std::atomic<int32_t> pid;   // 0 = not attached
+    std::atomic<int64_t> heartbeat_ns;                          // CLOCK_MONOTONIC, system wide
+
+    audio_shm_peer() : pid(0), heartbeat_ns(0) {}
+};
+
+/**
+ * @brief Header at the start of a shared ring segment
+ * Geometry and format are written once by the producer before it sets
+ * ready; the ring indices live here too so both processes share them.
+ * The optional per-slot metadata follows at meta_offset, and slot storage
+ * starts at data_offset (both page aligned).
+ */
+struct audio_shm_header {
+    static const uint32_t MAGIC = 0x4b43524eu;  // "KCRN"
+    static const uint32_t VERSION = 3;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frame_size;
+    uint32_t mirrored;
+    uint64_t frame_count;
+    uint64_t meta_offset;                       // 0 = no metadata side channel
+    uint64_t data_offset;
+    audio_shm_format format;
+    std::atomic<uint32_t> ready;                // Set last by the producer
+
+    audio_shm_peer producer;
+    audio_shm_peer consumer;
+    audio_frame_ring_indices indices;
+
+    audio_shm_header()
+        : magic(0), version(0), frame_size(0), mirrored(0), frame_count(0), meta_offset(0), data_offset(0), ready(0) {}
+};
+
+/**
+ * @brief Named shared-memory segment for a cross-process ring
+ * Owns the POSIX shared memory object and the mapping of its header. The
+ * slot storage is mapped separately (see audio_ring_memory::mapShared) so
+ * the data region can be mirrored exactly like a private ring.
+ */
+class audio_shm_segment {
+private:
+    std::string name;
+    int fd;
+    audio_shm_header* header;
+    size_t header_bytes;        // Size of the header (+ metadata) mapping
+    audio_shm_role role;
+
+    bool mapHeader(size_t bytes);
+    static size_t headerMappingBytes();
+    static bool reclaimStale(const std::string& segmentName, int64_t staleAfterNs);
+    audio_shm_peer& self() const;
+    audio_shm_peer& peer() const;
+
+public:
+    audio_shm_segment();
+    ~audio_shm_segment();
+
+    // Producer side: create a fresh segment. A segment left under the name by a producer
+    // that no longer exists is unlinked and replaced; one with a live producer fails
+    bool create(const std::string& segmentName, size_t frameSize, size_t frameCount, bool mirrored,
+                bool withFrameMeta, const audio_shm_format& format = audio_shm_format(),
+                int64_t staleAfterNs = 100000000);
+    void markReady();
+
+    // Consumer side: open a segment the producer has marked ready
+    bool attach(const std::string& segmentName);
+
+    void detach();
+    bool isOpen() const;
+
+    int getFd() const;
+    audio_shm_role getRole() const;
+    const std::string& getName() const;
+    size_t getFrameSize() const;
+    size_t getFrameCount() const;
+    size_t getDataOffset() const;
+    bool isMirrored() const;
+    audio_shm_format getFormat() const;
+    audio_frame_ring_indices* getIndices() const;
+    audio_frame_meta* getFrameMeta() const;     // Null when the producer disabled metadata
+
+    // Liveness: heartbeat is one relaxed store; the peer check only makes a
+    // syscall once the peer heartbeat is older than staleAfterNs
+    void heartbeat();
+    audio_shm_peer_state getPeerState(int64_t staleAfterNs) const;
+};
+
+} // namespace kcobain
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "iaudio_source.h"
+
+namespace kcobain {
+
+/**
+ * @brief Test signals a producer can generate
+ */
+enum class audio_signal_type {
+    noise,      // White noise, xorshift32 in independent lanes
+    sine,       // Fixed tone from a phase accumulator
+    sweep,      // Logarithmic sweep from frequencyHz to sweepEndHz, repeating
+    impulse,    // One full-scale sample every impulseIntervalFrames
+    silence
+};
+
+/**
+ * @brief Signal generator configuration
+ */
+struct audio_signal_config {
+    audio_signal_type type;
+    float amplitude;                // Peak level (1.0 = full scale)
+    double frequencyHz;             // Tone frequency / sweep start
+    double sweepEndHz;
+    double sweepSeconds;            // Duration of one sweep before it restarts
+    uint32_t impulseIntervalFrames; // Sample frames between impulses
+    uint32_t sampleRate;
+    uint32_t channels;              // Interleaved; every channel gets the same signal except noise
+    uint32_t seed;                  // Noise seed (0 picks a fixed default)
+
+    audio_signal_config()
+        : type(audio_signal_type::noise), amplitude(1.0f), frequencyHz(1000.0), sweepEndHz(20000.0),
+          sweepSeconds(10.0), impulseIntervalFrames(9600), sampleRate(96000), channels(2), seed(0) {}
+};
+
+/**
+ * @brief Block signal generator
+ * Fills whole blocks of interleaved float samples. The kernels work on
+ * fixed-width lanes with no loop-carried dependency inside a block, so the
+ * compiler can keep them in vector registers; per-sample cost is a few
+ * arithmetic operations and no library calls.
+ */
+class audio_signal_generator : public iaudio_source {
+public:
+    static const size_t LANES = 8;
+
+private:
+    audio_signal_config config;
+    uint32_t noise_state[LANES];    // One xorshift32 state per lane
+    double phase;                   // Cycles, [0, 1)
+    double phase_increment;         // Cycles per sample frame
+    double start_increment;         // phase_increment at the start of each sweep
+    double sweep_ratio;             // Per-frame increment multiplier for the log sweep
+    uint64_t sweep_frame;           // Frames into the current sweep
+    uint64_t sweep_length;          // Frames per sweep
+    uint64_t impulse_countdown;     // Frames until the next impulse
+
+    void fillNoise(float* samples, size_t sampleCount);
+    void fillSine(float* samples, size_t sampleFrames);
+    void fillSweep(float* samples, size_t sampleFrames);
+    void fillImpulse(float* samples, size_t sampleFrames);
+
+public:
+    audio_signal_generator();
+
+    bool initialize(const audio_signal_config& signalConfig);
+    const audio_signal_config& getConfig() const;
+
+    // Interleaved samples for sampleFrames frames (sampleFrames * channels floats)
+    void fill(float* samples, size_t sampleFrames);
+
+    // A batch of microframe slots: payloadBytes of samples at the start of each
+    // slot, the rest of the slot zeroed; slots may be unaligned for floats
+    void fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) override;
+
+    bool start() override;
+    void stop() override;
+    const char* getName() const override;
+
+    static const char* getTypeName(audio_signal_type type);
+};
+
+} // namespace kcobain
@@ -0,0 +1,251 @@
+#include "audio_thread_policy.h"
+#include "../../include/kcobain/logger.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__linux__)
+    #include <alloca.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <linux/capability.h>
+    #include <sys/mman.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_THREAD_POLICY
+#endif
+
+namespace kcobain {
+
+audio_thread_policy audio_thread_policy::realtime(int fifoPriority, uint64_t cpus) {
+    audio_thread_policy policy;
+    policy.schedClass = audio_sched_class::fifo;
+    policy.priority = fifoPriority;
+    policy.cpuMask = cpus;
+    policy.prefaultStackBytes = 256 * 1024;
+    return policy;
+}
+
+const char* audio_sched_class_name(audio_sched_class schedClass) {
+    switch (schedClass) {
+        case audio_sched_class::inherit: return "inherited";
+        case audio_sched_class::other: return "SCHED_OTHER";
+        case audio_sched_class::fifo: return "SCHED_FIFO";
+        case audio_sched_class::round_robin: return "SCHED_RR";
+    }
+    return "unknown";
+}
+
+std::string audio_thread_policy_result::describe() const {
+    std::string text = audio_sched_class_name(schedClass);
+    if (schedClass == audio_sched_class::fifo || schedClass == audio_sched_class::round_robin) {
+        text += " " + std::to_string(priority);
+    }
+    if (cpuMask != 0) {
+        std::string cpus;
+        for (size_t cpu = 0; cpu < 64; ++cpu) {
+            if (cpuMask & (static_cast<uint64_t>(1) << cpu)) {
+                cpus += (cpus.empty() ? "" : ",") + std::to_string(cpu);
+            }
+        }
+        text += ", CPUs " + cpus;
+    }
+    if (stackPrefaultedBytes > 0) {
+        text += ", " + std::to_string(stackPrefaultedBytes / 1024) + " KB stack prefaulted";
+    }
+    return text;
+}
+
+#ifdef KCOBAIN_HAS_THREAD_POLICY
+
+namespace {
+
+int toPosixPolicy(audio_sched_class schedClass) {
+    switch (schedClass) {
+        case audio_sched_class::fifo: return SCHED_FIFO;
+        case audio_sched_class::round_robin: return SCHED_RR;
+        default: return SCHED_OTHER;
+    }
+}
+
+audio_sched_class fromPosixPolicy(int policy) {
+    switch (policy) {
+        case SCHED_FIFO: return audio_sched_class::fifo;
+        case SCHED_RR: return audio_sched_class::round_robin;
+        default: return audio_sched_class::other;
+    }
+}
+
+// Its own frame, so the touched region is released (but stays mapped) on return
+__attribute__((noinline)) void touchStack(size_t bytes) {
+    volatile unsigned char* region = static_cast<volatile unsigned char*>(alloca(bytes));
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (size_t offset = 0; offset < bytes; offset += page) {
+        region[offset] = 0;
+    }
+}
+
+size_t prefaultStack(size_t requested) {
+    // Never come near the guard page: at most half the thread's stack
+    pthread_attr_t attr;
+    size_t stackSize = 0;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        pthread_attr_getstacksize(&attr, &stackSize);
+        pthread_attr_destroy(&attr);
+    }
+    size_t bytes = requested;
+    if (stackSize > 0 && bytes > stackSize / 2) {
+        bytes = stackSize / 2;
+    }
+    if (bytes > 0) touchStack(bytes);
+    return bytes;
+}
+
+bool hasIpcLockCapability() {
+    struct __user_cap_header_struct header;
+    struct __user_cap_data_struct data[_LINUX_CAPABILITY_U32S_3];
+    header.version = _LINUX_CAPABILITY_VERSION_3;
+    header.pid = 0;
+    if (syscall(SYS_capget, &header, data) != 0) return false;
+    return (data[CAP_IPC_LOCK / 32].effective & (1u << (CAP_IPC_LOCK % 32))) != 0;
+}
+
+} // namespace
+
+audio_thread_policy_result audio_apply_thread_policy(const audio_thread_policy& policy, const char* threadName) {
+    audio_thread_policy_result result;
+    result.applied = true;
+    const std::string name = threadName ? threadName : "audio";
+
+    // Stack first: the faults are taken before the thread becomes real-time
+    if (policy.prefaultStackBytes > 0) {
+        result.stackPrefaultedBytes = prefaultStack(policy.prefaultStackBytes);
+        if (result.stackPrefaultedBytes < policy.prefaultStackBytes) {
+            LOG_WARN(name + " thread stack prefault limited to " + std::to_string(result.stackPrefaultedBytes / 1024) +
+                     " KB (half the stack)");
+        }
+    }
+
+    if (policy.cpuMask != 0) {
+        // Only CPUs this process may use (cpuset, taskset) are requested
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        cpu_set_t wanted;
+        CPU_ZERO(&wanted);
+        for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+            if ((policy.cpuMask & (static_cast<uint64_t>(1) << cpu)) && CPU_ISSET(cpu, &allowed)) {
+                CPU_SET(cpu, &wanted);
+            }
+        }
+        if (CPU_COUNT(&wanted) == 0) {
+            result.fellBack = true;
+            LOG_WARN(name + " thread affinity not applied - none of the requested CPUs are available");
+        } else {
+            int error = pthread_setaffinity_np(pthread_self(), sizeof(wanted), &wanted);
+            if (error != 0) {
+                result.fellBack = true;
+                LOG_WARN(name + " thread affinity not applied (" + std::strerror(error) + ")");
+            } else if (CPU_COUNT(&wanted) < __builtin_popcountll(policy.cpuMask)) {
+                result.fellBack = true;
+                LOG_WARN(name + " thread pinned to a subset of the requested CPUs - the rest are not available");
+            }
+        }
+    }
+
+    if (policy.schedClass != audio_sched_class::inherit) {
+        int posixPolicy = toPosixPolicy(policy.schedClass);
+        struct sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        if (posixPolicy != SCHED_OTHER) {
+            int minPriority = sched_get_priority_min(posixPolicy);
+            int maxPriority = sched_get_priority_max(posixPolicy);
+            param.sched_priority = policy.priority < minPriority ? minPriority
+                                 : policy.priority > maxPriority ? maxPriority : policy.priority;
+        }
+        int error = pthread_setschedparam(pthread_self(), posixPolicy, &param);
+        if (error != 0) {
+            result.fellBack = true;
+            LOG_WARN(name + " thread stays on its default scheduler - " +
+                     audio_sched_class_name(policy.schedClass) + " refused (" + std::strerror(error) +
+                     (error == EPERM ? ", needs CAP_SYS_NICE or RLIMIT_RTPRIO" : "") + ")");
+        }
+    }
+
+    // Report what is in effect, not what was asked for
+    int currentPolicy = SCHED_OTHER;
+    struct sched_param current;
+    std::memset(&current, 0, sizeof(current));
+    if (pthread_getschedparam(pthread_self(), &currentPolicy, &current) == 0) {
+        result.schedClass = fromPosixPolicy(currentPolicy);
+        result.priority = current.sched_priority;
+    }
+    if (policy.cpuMask != 0) {
+        cpu_set_t effective;
+        CPU_ZERO(&effective);
+        if (pthread_getaffinity_np(pthread_self(), sizeof(effective), &effective) == 0) {
+            for (int cpu = 0; cpu < 64 && cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &effective)) result.cpuMask |= static_cast<uint64_t>(1) << cpu;
+            }
+        }
+    }
+
+    if (policy.schedClass != audio_sched_class::inherit || policy.cpuMask != 0 || policy.prefaultStackBytes > 0) {
+        LOG_INFO("📌 " + name + " thread: " + result.describe());
+    }
+    return result;
+}
+
+bool audio_lock_process_memory() {
+    // Under a finite RLIMIT_MEMLOCK, MCL_FUTURE makes every later mapping count against
+    // the limit: the next thread stack past it fails to allocate. Lock what exists only.
+    int flags = MCL_CURRENT | MCL_FUTURE;
+    struct rlimit limit;
+    if (!hasIpcLockCapability() && getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        if (limit.rlim_max == RLIM_INFINITY) {
+            limit.rlim_cur = RLIM_INFINITY;
+            setrlimit(RLIMIT_MEMLOCK, &limit);
+        }
+        if (limit.rlim_cur != RLIM_INFINITY) {
+            flags = MCL_CURRENT;
+            LOG_WARN("RLIMIT_MEMLOCK is " + std::to_string(limit.rlim_cur / 1024) + 
+                     " KB without CAP_IPC_LOCK - locking current pages only, later allocations stay pageable");
+        }
+    }
+    if (mlockall(flags) != 0) {
+        LOG_WARN(std::string("mlockall failed (") + std::strerror(errno) +
+                 ") - check RLIMIT_MEMLOCK / CAP_IPC_LOCK; memory may be paged out");
+        return false;
+    }
+    LOG_INFO(std::string("📌 Process memory locked (") + 
+             (flags & MCL_FUTURE ? "current and future pages" : "current pages") + ")");
+    return true;
+}
+
+void audio_unlock_process_memory() {
+    munlockall();
+}
+
+#else
+
+audio_thread_policy_result audio_apply_thread_policy(const audio_thread_policy& policy, const char* threadName) {
+    audio_thread_policy_result result;
+    result.applied = true;
+    if (policy.schedClass != audio_sched_class::inherit || policy.cpuMask != 0 || policy.prefaultStackBytes > 0) {
+        result.fellBack = true;
+        LOG_WARN(std::string(threadName ? threadName : "audio") + " thread policy is not supported on this platform");
+    }
+    return result;
+}
+
+bool audio_lock_process_memory() {
+    LOG_WARN("Locking process memory is not supported on this platform");
+    return false;
+}
+
+void audio_unlock_process_memory() {
+}
+
+#endif
+
+} // namespace kcobain
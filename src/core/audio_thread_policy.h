@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace kcobain {
+
+/**
+ * @brief Scheduling class for a streaming thread
+ */
+enum class audio_sched_class {
+    inherit,        // Leave the thread as created (normally SCHED_OTHER)
+    other,          // SCHED_OTHER, priority is ignored
+    fifo,           // SCHED_FIFO, priority 1-99
+    round_robin     // SCHED_RR, priority 1-99
+};
+
+/**
+ * @brief Real-time policy for one streaming thread
+ * Applied by the thread itself when it starts; anything the process is not
+ * allowed to do (no CAP_SYS_NICE, RLIMIT_RTPRIO of 0, CPUs outside the
+ * cpuset) is skipped with a warning and the thread runs as it was.
+ */
+struct audio_thread_policy {
+    audio_sched_class schedClass;
+    int priority;                   // Clamped to the class's range
+    uint64_t cpuMask;               // Bit n = CPU n; 0 leaves the affinity alone
+    size_t prefaultStackBytes;      // Touch this much stack up front (0 = none)
+
+    audio_thread_policy() : schedClass(audio_sched_class::inherit), priority(0), cpuMask(0), prefaultStackBytes(0) {}
+
+    static audio_thread_policy realtime(int fifoPriority, uint64_t cpus = 0);   // SCHED_FIFO, 256 KB stack prefault
+};
+
+/**
+ * @brief What a thread actually got
+ */
+struct audio_thread_policy_result {
+    bool applied;                   // The thread has run audio_apply_thread_policy
+    audio_sched_class schedClass;   // Class in effect afterwards
+    int priority;
+    uint64_t cpuMask;               // Affinity in effect afterwards (first 64 CPUs)
+    size_t stackPrefaultedBytes;
+    bool fellBack;                  // Part of the request was refused
+
+    audio_thread_policy_result()
+        : applied(false), schedClass(audio_sched_class::inherit), priority(0), cpuMask(0), stackPrefaultedBytes(0),
+          fellBack(false) {}
+
+    std::string describe() const;   // e.g. "SCHED_FIFO 80, CPUs 3, 256 KB stack prefaulted"
+};
+
+/**
+ * @brief Thread policies the orchestrator hands to its producers and consumer
+ */
+struct audio_thread_config {
+    audio_thread_policy producer;   // Every producer lane
+    audio_thread_policy consumer;
+    bool lockAllMemory;             // mlockall(MCL_CURRENT | MCL_FUTURE) before streaming starts
+
+    audio_thread_config() : lockAllMemory(false) {}
+};
+
+// Applies the policy to the calling thread and logs what was applied under threadName
+audio_thread_policy_result audio_apply_thread_policy(const audio_thread_policy& policy, const char* threadName);
+// mlockall(MCL_CURRENT | MCL_FUTURE); false (with a warning) when the process may not lock its memory
+bool audio_lock_process_memory();
+// munlockall: releases every lock in the process, including mlock'd ring pages
+void audio_unlock_process_memory();
+const char* audio_sched_class_name(audio_sched_class schedClass);
+
+} // namespace kcobain
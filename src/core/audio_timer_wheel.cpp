@@ -0,0 +1,113 @@
+#include "audio_timer_wheel.h"
+#include "../../include/kcobain/logger.h"
+#include <algorithm>
+
+namespace kcobain {
+
+audio_timer_wheel::audio_timer_wheel()
+    : slot_mask(0), tick_ns(1), origin_ns(0), current_tick(0), pending(0) {
+}
+
+bool audio_timer_wheel::initialize(size_t slotCount, int64_t tickNs, int64_t originNs) {
+    if (slotCount == 0 || tickNs <= 0) {
+        LOG_ERROR("Invalid timer wheel: " + std::to_string(slotCount) + " slots of " + std::to_string(tickNs) + "ns");
+        return false;
+    }
+    size_t count = 1;
+    while (count < slotCount) count <<= 1;
+    
+    slots.assign(count, nullptr);
+    slot_mask = count - 1;
+    tick_ns = tickNs;
+    origin_ns = originNs;
+    current_tick = 0;
+    pending = 0;
+    return true;
+}
+
+uint64_t audio_timer_wheel::tickOf(int64_t timeNs) const {
+    return timeNs <= origin_ns ? 0 : static_cast<uint64_t>((timeNs - origin_ns) / tick_ns);
+}
+
+void audio_timer_wheel::schedule(audio_timer_node* node) {
+    uint64_t tick = tickOf(node->deadline_ns);
+    if (tick < current_tick) tick = current_tick;
+    
+    // Sorted insert keeps each slot in deadline order (later rounds sort last)
+    audio_timer_node** link = &slots[tick & slot_mask];
+    while (*link && (*link)->deadline_ns <= node->deadline_ns) {
+        link = &(*link)->next;
+    }
+    node->next = *link;
+    *link = node;
+    ++pending;
+}
+
+void audio_timer_wheel::cancel(audio_timer_node* node) {
+    uint64_t tick = tickOf(node->deadline_ns);
+    if (tick < current_tick) tick = current_tick;
+    for (audio_timer_node** link = &slots[tick & slot_mask]; *link; link = &(*link)->next) {
+        if (*link == node) {
+            *link = node->next;
+            node->next = nullptr;
+            --pending;
+            return;
+        }
+    }
+}
+
+audio_timer_node* audio_timer_wheel::expire(int64_t nowNs) {
+    audio_timer_node* head = nullptr;
+    audio_timer_node** tail = &head;
+    if (pending == 0) {
+        current_tick = std::max(current_tick, tickOf(nowNs));
+        return nullptr;
+    }
+    
+    // After a stall longer than a revolution every slot is visited once
+    uint64_t nowTick = tickOf(nowNs);
+    uint64_t lastTick = nowTick;
+    if (lastTick - current_tick > slot_mask) lastTick = current_tick + slot_mask;
+    
+    for (uint64_t tick = current_tick; tick <= lastTick && pending > 0; ++tick) {
+        audio_timer_node** link = &slots[tick & slot_mask];
+        while (*link && (*link)->deadline_ns <= nowNs) {
+            audio_timer_node* node = *link;
+            *link = node->next;
+            node->next = nullptr;
+            *tail = node;
+            tail = &node->next;
+            --pending;
+        }
+    }
+    // The current tick may still hold events due later within it
+    current_tick = nowTick;
+    return head;
+}
+
+int64_t audio_timer_wheel::nextDeadline() const {
+    if (pending == 0) return -1;
+    
+    // A slot head within the revolution being scanned is the answer; heads of
+    // later rounds are skipped and only used if nothing nearer exists
+    int64_t earliest = -1;
+    for (size_t step = 0; step <= slot_mask; ++step) {
+        const audio_timer_node* node = slots[(current_tick + step) & slot_mask];
+        if (!node) continue;
+        if (tickOf(node->deadline_ns) <= current_tick + step) {
+            return node->deadline_ns;
+        }
+        if (earliest < 0 || node->deadline_ns < earliest) earliest = node->deadline_ns;
+    }
+    return earliest;
+}
+
+size_t audio_timer_wheel::size() const {
+    return pending;
+}
+
+int64_t audio_timer_wheel::getTickNs() const {
+    return tick_ns;
+}
+
+} // namespace kcobain
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kcobain {
+
+/**
+ * @brief A pending event on an audio_timer_wheel
+ * Intrusive and owned by the caller, so scheduling never allocates. owner
+ * and kind are free for the caller to identify what fires.
+ */
+struct audio_timer_node {
+    int64_t deadline_ns;        // Steady clock
+    audio_timer_node* next;
+    uint32_t owner;
+    uint32_t kind;
+    
+    audio_timer_node() : deadline_ns(0), next(nullptr), owner(0), kind(0) {}
+};
+
+/**
+ * @brief Hashed timer wheel for microframe events
+ * Slots cover tickNs each; a deadline lands in slot (tick mod slotCount)
+ * and each slot list is kept in deadline order, so expiry hands events back
+ * sorted within a tick and in tick order across ticks. Deadlines beyond one
+ * revolution stay in their slot until their round comes up. Insert is O(1)
+ * plus the (short) slot list; finding the next deadline scans forward from
+ * the current tick. Single threaded.
+ */
+class audio_timer_wheel {
+private:
+    std::vector<audio_timer_node*> slots;
+    size_t slot_mask;
+    int64_t tick_ns;
+    int64_t origin_ns;
+    uint64_t current_tick;      // Every tick before this one has been expired
+    size_t pending;
+
+    uint64_t tickOf(int64_t timeNs) const;
+
+public:
+    audio_timer_wheel();
+    
+    // slotCount is rounded up to a power of two
+    bool initialize(size_t slotCount, int64_t tickNs, int64_t originNs);
+    
+    // Deadlines already in the past fire on the next expire()
+    void schedule(audio_timer_node* node);
+    void cancel(audio_timer_node* node);
+    
+    // Unlink every node with deadline <= nowNs; returns them as a list through next
+    audio_timer_node* expire(int64_t nowNs);
+    
+    // Earliest pending deadline, or -1 when empty
+    int64_t nextDeadline() const;
+    
+    size_t size() const;
+    int64_t getTickNs() const;
+};
+
+} // namespace kcobain
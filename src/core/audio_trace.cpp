@@ -0,0 +1,206 @@
+#include "audio_trace.h"
+#include "audio_wait_strategy.h"
+#include "../../include/kcobain/logger.h"
+#include "../../external/miniaudio.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace kcobain {
+
+audio_trace_ring::audio_trace_ring() : memory(nullptr), dropped(0), reported_dropped(0) {
+}
+
+audio_trace_ring::~audio_trace_ring() {
+    uninitialize();
+}
+
+bool audio_trace_ring::initialize(const std::string& threadName, const audio_trace_config& traceConfig) {
+    uninitialize();
+    name = threadName;
+    config = traceConfig;
+    if (config.capacity == 0) config.capacity = audio_trace_config().capacity;
+
+    const size_t bytes = sizeof(audio_trace_event) * config.capacity;
+    memory = ma_aligned_malloc(bytes, KCOBAIN_CACHE_LINE_SIZE, NULL);
+    if (!memory || !ring.initialize(memory, sizeof(audio_trace_event), config.capacity, false)) {
+        LOG_ERROR("Failed to allocate " + std::to_string(config.capacity) + " trace events for " + name);
+        uninitialize();
+        return false;
+    }
+    // Touch the events now rather than on the audio thread's first records
+    std::memset(memory, 0, bytes);
+    dropped.store(0);
+    reported_dropped = 0;
+    return true;
+}
+
+void audio_trace_ring::uninitialize() {
+    ring.uninitialize();
+    if (memory) {
+        ma_aligned_free(memory, NULL);
+        memory = nullptr;
+    }
+}
+
+bool audio_trace_ring::isInitialized() const {
+    return memory != nullptr;
+}
+
+void audio_trace_ring::record(audio_trace_type type, uint64_t v0, uint64_t v1, uint64_t v2, uint64_t v3,
+                              uint64_t v4, uint64_t v5) {
+    if (!memory) return;
+
+    size_t frames = 1;
+    void* slot = nullptr;
+    if (ring.acquireWriteFrames(&frames, &slot) != MA_SUCCESS || frames == 0) {
+        // Single writer: a plain increment, readable from the drain thread
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+    audio_trace_event* event = static_cast<audio_trace_event*>(slot);
+    event->time_ns = audio_steady_time_ns();
+    event->type = type;
+    event->reserved = 0;
+    event->values[0] = v0;
+    event->values[1] = v1;
+    event->values[2] = v2;
+    event->values[3] = v3;
+    event->values[4] = v4;
+    event->values[5] = v5;
+    ring.commitWriteFrames(1);
+}
+
+bool audio_trace_ring::tracesCommits() const {
+    return config.traceCommits;
+}
+
+const std::string& audio_trace_ring::getName() const {
+    return name;
+}
+
+uint64_t audio_trace_ring::getDroppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+audio_trace_drain::audio_trace_drain() : running(false), generation(0) {
+}
+
+audio_trace_drain::~audio_trace_drain() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_all();
+    if (drain_thread.joinable()) {
+        drain_thread.join();
+    }
+}
+
+audio_trace_drain& audio_trace_drain::shared() {
+    static audio_trace_drain drain;
+    return drain;
+}
+
+void audio_trace_drain::attach(audio_trace_ring* ring) {
+    if (!ring || !ring->isInitialized()) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (std::find(rings.begin(), rings.end(), ring) != rings.end()) return;
+    rings.push_back(ring);
+    if (!running) {
+        running = true;
+        ++generation;
+        const uint64_t threadGeneration = generation;
+        drain_thread = std::thread([this, threadGeneration]() { drainLoop(threadGeneration); });
+    }
+}
+
+void audio_trace_drain::detach(audio_trace_ring* ring) {
+    std::thread finished;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::vector<audio_trace_ring*>::iterator it = std::find(rings.begin(), rings.end(), ring);
+        if (it == rings.end()) return;
+        drainRing(ring);
+        rings.erase(it);
+        if (rings.empty() && running) {
+            running = false;
+            finished.swap(drain_thread);
+        }
+    }
+    wake.notify_all();
+    if (finished.joinable()) finished.join();
+}
+
+void audio_trace_drain::drainLoop(uint64_t threadGeneration) {
+    std::unique_lock<std::mutex> guard(lock);
+    // A thread told to stop exits even if a later attach has started its successor
+    while (running && generation == threadGeneration) {
+        for (size_t i = 0; i < rings.size(); ++i) {
+            drainRing(rings[i]);
+        }
+        wake.wait_for(guard, std::chrono::milliseconds(DRAIN_PERIOD_MS));
+    }
+}
+
+size_t audio_trace_drain::drainRing(audio_trace_ring* ring) {
+    size_t drained = 0;
+    for (;;) {
+        size_t frames = ring->ring.getFrameCount();
+        void* events = nullptr;
+        if (ring->ring.acquireReadFrames(&frames, &events) != MA_SUCCESS || frames == 0) break;
+        for (size_t i = 0; i < frames; ++i) {
+            format(ring->name, static_cast<const audio_trace_event*>(events)[i]);
+        }
+        ring->ring.commitReadFrames(frames);
+        drained += frames;
+    }
+
+    uint64_t dropped = ring->getDroppedCount();
+    if (dropped != ring->reported_dropped) {
+        LOG_WARN(ring->name + " trace dropped " + std::to_string(dropped - ring->reported_dropped) +
+                 " events - the ring filled between drains");
+        ring->reported_dropped = dropped;
+    }
+    return drained;
+}
+
+void audio_trace_drain::format(const std::string& name, const audio_trace_event& event) {
+    const uint64_t* v = event.values;
+    switch (event.type) {
+        case audio_trace_type::underrun:
+            LOG_WARN("USB underrun: expected " + std::to_string(v[0]) + " microframes, got " + std::to_string(v[1]) +
+                     " (microframe #" + std::to_string(v[2]) + ")");
+            break;
+        case audio_trace_type::late_wakeup:
+            LOG_DEBUG(name + " woke " + std::to_string(v[0] / 1000) + "μs late - " + std::to_string(v[1]) +
+                      " microframes due at once");
+            break;
+        case audio_trace_type::commit:
+            LOG_DEBUG(name + " microframe #" + std::to_string(v[0]) + ": read " + std::to_string(v[1]) +
+                      " microframes, " + std::to_string(v[2]) + " sample frames");
+            break;
+        case audio_trace_type::producer_lost:
+            LOG_ERROR("Producer process is gone - streaming underruns until it returns (microframe #" +
+                      std::to_string(v[0]) + ")");
+            break;
+        case audio_trace_type::producer_back:
+            LOG_INFO("Producer process is back (microframe #" + std::to_string(v[0]) + ")");
+            break;
+        case audio_trace_type::status: {
+            std::string line = "USB microframe #" + std::to_string(v[0]) + " - Wake-up error p99/max: " +
+                               std::to_string(v[2] / 1000) + "/" + std::to_string(v[3] / 1000) + "μs";
+            if (v[5] > 0) {
+                line += " - Queueing p99/max: " + std::to_string(v[4] / 1000) + "/" + std::to_string(v[5] / 1000) + "μs";
+            }
+            LOG_INFO(line + " - Underruns: " + std::to_string(v[1]));
+            break;
+        }
+        default:
+            LOG_WARN(name + " trace event of unknown type " + std::to_string(static_cast<uint32_t>(event.type)));
+            break;
+    }
+}
+
+} // namespace kcobain
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_frame_ring.h"
+
+namespace kcobain {
+
+/**
+ * @brief Trace event types
+ * The values each type carries are listed next to it.
+ */
+enum class audio_trace_type : uint32_t {
+    underrun = 1,       // due microframes, microframes read, microframe count
+    late_wakeup,        // lateness ns, due microframes
+    commit,             // microframe count, microframes read, sample frames (only with traceCommits)
+    producer_lost,      // microframe count
+    producer_back,      // microframe count
+    status              // microframe count, underruns, wake p99 ns, wake max ns, queueing p99 ns, queueing max ns
+};
+
+/**
+ * @brief One binary trace record, a cache line
+ */
+struct audio_trace_event {
+    static const size_t VALUE_COUNT = 6;
+
+    int64_t time_ns;                // audio_steady_time_ns() when recorded
+    audio_trace_type type;
+    uint32_t reserved;
+    uint64_t values[VALUE_COUNT];
+};
+
+/**
+ * @brief Trace ring configuration
+ */
+struct audio_trace_config {
+    size_t capacity;                // Events held between drains
+    bool traceCommits;              // One commit event per consumer read (8000/s, formatted at DEBUG)
+
+    audio_trace_config() : capacity(4096), traceCommits(false) {}
+};
+
+/**
+ * @brief Per-thread binary trace ring
+ * The owning audio thread records fixed-size events into a preallocated
+ * SPSC ring: no allocation, no lock, no system call. A full ring drops the
+ * event and counts it. audio_trace_drain formats the events on its own
+ * thread.
+ */
+class audio_trace_ring {
+private:
+    audio_frame_ring ring;
+    void* memory;
+    std::string name;               // Prefix for formatted events
+    audio_trace_config config;
+    std::atomic<uint64_t> dropped;
+    uint64_t reported_dropped;      // Drain thread only
+
+    friend class audio_trace_drain;
+
+public:
+    audio_trace_ring();
+    ~audio_trace_ring();
+
+    bool initialize(const std::string& threadName, const audio_trace_config& traceConfig = audio_trace_config());
+    void uninitialize();
+    bool isInitialized() const;
+
+    // Owning thread only
+    void record(audio_trace_type type, uint64_t v0 = 0, uint64_t v1 = 0, uint64_t v2 = 0, uint64_t v3 = 0,
+                uint64_t v4 = 0, uint64_t v5 = 0);
+    bool tracesCommits() const;
+
+    const std::string& getName() const;
+    uint64_t getDroppedCount() const;
+};
+
+/**
+ * @brief Background formatter for trace rings
+ * One shared drain thread polls every attached ring and turns its events
+ * into log lines. The thread runs while at least one ring is attached.
+ * Detaching formats whatever the ring still holds, so call it after the
+ * owning thread has stopped recording.
+ */
+class audio_trace_drain {
+private:
+    static const uint32_t DRAIN_PERIOD_MS = 10;
+
+    std::mutex lock;                // Guards rings, running and generation
+    std::condition_variable wake;
+    std::vector<audio_trace_ring*> rings;
+    std::thread drain_thread;
+    bool running;
+    uint64_t generation;            // Bumped per drain thread started
+
+    audio_trace_drain();
+    void drainLoop(uint64_t threadGeneration);
+    size_t drainRing(audio_trace_ring* ring);
+    static void format(const std::string& name, const audio_trace_event& event);
+
+public:
+    ~audio_trace_drain();
+
+    static audio_trace_drain& shared();
+
+    void attach(audio_trace_ring* ring);
+    void detach(audio_trace_ring* ring);
+};
+
+} // namespace kcobain
@@ -0,0 +1,57 @@
+#include "audio_wait_strategy.h"
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+    #include <linux/futex.h>
+    #include <sys/syscall.h>
+    #include <time.h>
+    #include <unistd.h>
+    #define KCOBAIN_HAS_FUTEX
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace kcobain {
+
+void audio_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#else
+    std::atomic_signal_fence(std::memory_order_seq_cst);
+#endif
+}
+
+int64_t audio_steady_time_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void audio_futex_wait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t timeoutMicros) {
+#ifdef KCOBAIN_HAS_FUTEX
+    // Not FUTEX_PRIVATE: the word may live in memory shared with another process
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMicros / 1000000;
+    timeout.tv_nsec = (timeoutMicros % 1000000) * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, NULL, 0);
+#else
+    // No futex: fall back to a short sleep, the caller re-checks the ring
+    if (word->load(std::memory_order_acquire) == expected) {
+        std::this_thread::sleep_for(std::chrono::microseconds(timeoutMicros < 100 ? timeoutMicros : 100));
+    }
+#endif
+}
+
+void audio_futex_wake(std::atomic<uint32_t>* word) {
+#ifdef KCOBAIN_HAS_FUTEX
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, 1, NULL, NULL, 0);
+#else
+    (void)word;
+#endif
+}
+
+} // namespace kcobain
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace kcobain {
+
+/**
+ * @brief How a producer waits when the ring is full
+ */
+enum class audio_wait_mode {
+    spin_yield,     // Spin with a pause instruction, then yield the core
+    futex,          // Park on a futex; the consumer wakes it after a read commit
+    timed_sleep     // Sleep a fixed interval and retry
+};
+
+/**
+ * @brief Wait strategy configuration
+ */
+struct audio_wait_config {
+    audio_wait_mode mode;
+    uint32_t spinCount;         // Pause iterations before yielding / parking
+    uint32_t sleepMicros;       // timed_sleep interval
+    uint32_t timeoutMicros;     // Upper bound on one futex park (covers stop())
+    
+    audio_wait_config() : mode(audio_wait_mode::futex), spinCount(64), sleepMicros(50), timeoutMicros(2000) {}
+};
+
+/**
+ * @brief Backpressure statistics for a producer
+ * A wait is one pass through the wait strategy because the ring was full;
+ * it is not an overrun, nothing is dropped.
+ */
+struct audio_wait_stats {
+    uint64_t waits;                 // Times the producer found the ring full
+    uint64_t wakeups;               // Futex wake-ups issued by the consumer
+    uint64_t totalWakeLatencyNs;    // Sum of consumer-wake → producer-running latency
+    uint64_t maxWakeLatencyNs;
+    
+    audio_wait_stats() : waits(0), wakeups(0), totalWakeLatencyNs(0), maxWakeLatencyNs(0) {}
+};
+
+// Wait primitives shared by the rings
+void audio_cpu_relax();
+int64_t audio_steady_time_ns();
+void audio_futex_wait(std::atomic<uint32_t>* word, uint32_t expected, uint32_t timeoutMicros);
+void audio_futex_wake(std::atomic<uint32_t>* word);
+
+} // namespace kcobain
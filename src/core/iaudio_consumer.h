@@ -1,7 +1,11 @@
 #pragma once
 #include <cstdint>
+#include "audio_rb_telemetry.h"
+#include "audio_thread_policy.h"
 
 namespace kcobain {
+class audio_capture_writer;
+
 /**
  * @brief Audio Consumer Interface
  * Defines the contract for audio consumers
@@ -13,7 +17,15 @@ namespace kcobain {
         virtual void stop() = 0;
         virtual bool isRunning() const = 0;
         virtual uint32_t getTotalFramesConsumed() const = 0;
+        virtual uint64_t getTotalSamplesConsumed() const = 0;    // Sample frames, summed over variable-length packets
         virtual uint32_t getUnderrunCount() const = 0;
+        virtual uint64_t getPageFaultCount() const = 0;
+        virtual audio_latency_snapshot getLatencySnapshot() const = 0;
+        virtual audio_latency_snapshot getWakeupLateness() const = 0;   // Microframe wake-up minus deadline
+        virtual uint64_t getWakeupOversleeps() const = 0;               // Sleeps that overshot the spin margin
+        virtual void setCapture(audio_capture_writer* writer) = 0;   // Null stops recording
+        virtual void setThreadPolicy(const audio_thread_policy& policy) = 0;     // Applied when the thread starts
+        virtual audio_thread_policy_result getThreadPolicyResult() const = 0;
     };
 
 }
\ No newline at end of file
@@ -1,5 +1,9 @@
 #pragma once
 #include <cstdint>
+#include "audio_wait_strategy.h"
+#include "audio_rate_controller.h"
+#include "iaudio_source.h"
+#include "audio_thread_policy.h"
 
 namespace kcobain {
 /**
@@ -14,5 +18,13 @@ namespace kcobain {
         virtual bool isRunning() const = 0;
         virtual uint32_t getTotalFramesProduced() const = 0;
         virtual uint32_t getOverrunCount() const = 0;
+        virtual uint64_t getPageFaultCount() const = 0;
+        virtual uint64_t getLoopAllocationCount() const = 0;   // Only counted in alloc counter builds
+        virtual audio_wait_stats getWaitStats() const = 0;
+        virtual audio_pacing_stats getPacingStats() const = 0;
+        virtual void setSource(iaudio_source* source) = 0;     // Null restores the built-in signal
+        virtual iaudio_source* getSource() const = 0;
+        virtual void setThreadPolicy(const audio_thread_policy& policy) = 0;     // Applied when the thread starts
+        virtual audio_thread_policy_result getThreadPolicyResult() const = 0;
     };
 }
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "audio_sample_format.h"
+
+namespace kcobain {
+/**
+ * @brief Audio Source Interface
+ * Supplies the samples a producer packs into microframe slots. The producer
+ * calls fillMicroframes on its streaming thread, so an implementation must
+ * not block, allocate or do I/O there; slow work belongs on its own thread.
+ * Sources render interleaved 32-bit float, which the packer converts to the
+ * wire format. A source that already writes wire-format bytes says so in
+ * getWireFormat(); the packer then copies it verbatim, and only into a
+ * stream of exactly that format.
+ */
+ class iaudio_source {
+    public:
+        virtual ~iaudio_source() = default;
+        virtual bool start() = 0;       // Called before the producer thread starts
+        virtual void stop() = 0;        // Called after the producer thread has stopped
+        virtual void fillMicroframes(uint8_t* slots, size_t frameCount, size_t slotStride, size_t payloadBytes) = 0;
+        virtual const char* getName() const = 0;
+        virtual uint64_t getStarvedMicroframes() const { return 0; }   // Slots padded with silence for lack of data
+        virtual bool getWireFormat(audio_microframe_format* pFormat) const { (void)pFormat; return false; }  // False = float
+    };
+}
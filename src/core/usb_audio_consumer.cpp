@@ -1,18 +1,36 @@
 #include "usb_audio_consumer.h"
 #include "audio_rb_controller.h"
+#include "audio_capture.h"
 #include "../../include/kcobain/logger.h"
 #include "../../external/miniaudio.h"
-
+#include <algorithm>
+#include <cstring>
 
 namespace kcobain {
 
-usb_audio_consumer::usb_audio_consumer(audio_rb_controller* controller)
+usb_audio_consumer::usb_audio_consumer(audio_rb_controller* controller, const audio_microframe_format& microframeFormat,
+                                       const audio_timer_config& timerConfig, const audio_trace_config& traceConfig)
     : buffer_controller(controller), running(false),
-      total_frames_consumed(0), underrun_count(0) {
+      total_frames_consumed(0), underrun_count(0), total_samples_consumed(0), page_fault_count(0),
+      format(microframeFormat), timer(timerConfig), capture(nullptr) {
+    
+    if (!format.isValid()) {
+        LOG_WARN("Consumer falling back to the default microframe format");
+        format = audio_microframe_format();
+    }
+    trace.initialize("Consumer", traceConfig);
     
     if (!buffer_controller || !buffer_controller->isInitialized()) {
         LOG_ERROR("Consumer cannot be created - invalid or uninitialized buffer controller");
+        return;
     }
+    
+    for (size_t lane = 0; lane < buffer_controller->getProducerLaneCount(); ++lane) {
+        lane_latency.push_back(std::unique_ptr<audio_latency_telemetry>(new audio_latency_telemetry()));
+        lane_packets.push_back(audio_packet_scheduler());
+        lane_packets.back().initialize(format);
+    }
+    capture_sequence.assign(lane_latency.size(), 0);
 }
 
 usb_audio_consumer::~usb_audio_consumer() {
@@ -27,6 +45,8 @@ void usb_audio_consumer::start() {
         return;
     }
     
+    timer.reset();
+    audio_trace_drain::shared().attach(&trace);
     running = true;
     LOG_INFO("📥 USB Audio Consumer started");
     consumer_thread = std::thread([this]() { consumerLoop(); });
@@ -39,6 +59,8 @@ void usb_audio_consumer::stop() {
     if (consumer_thread.joinable()) {
         consumer_thread.join();
     }
+    // The loop has stopped recording: format what it left, then let the drain go
+    audio_trace_drain::shared().detach(&trace);
     LOG_INFO("📥 USB Audio Consumer stopped");
 }
 
@@ -50,62 +72,298 @@ uint32_t usb_audio_consumer::getTotalFramesConsumed() const {
     return total_frames_consumed.load();
 }
 
+uint64_t usb_audio_consumer::getTotalSamplesConsumed() const {
+    return total_samples_consumed.load();
+}
+
 uint32_t usb_audio_consumer::getUnderrunCount() const {
     return underrun_count.load();
 }
 
+uint64_t usb_audio_consumer::getPageFaultCount() const {
+    return page_fault_count.load();
+}
+
+audio_latency_snapshot usb_audio_consumer::getLatencySnapshot() const {
+    audio_latency_snapshot merged = audio_latency_snapshot();
+    for (size_t lane = 0; lane < lane_latency.size(); ++lane) {
+        merged.merge(lane_latency[lane]->snapshot());
+    }
+    return merged;
+}
+
+audio_latency_snapshot usb_audio_consumer::getWakeupLateness() const {
+    return timer.getLatenessSnapshot();
+}
+
+uint64_t usb_audio_consumer::getWakeupOversleeps() const {
+    return timer.getOversleepCount();
+}
+
+void usb_audio_consumer::setThreadPolicy(const audio_thread_policy& policy) {
+    if (running.load()) {
+        LOG_ERROR("Cannot change consumer thread policy while streaming");
+        return;
+    }
+    thread_policy = policy;
+}
+
+audio_thread_policy_result usb_audio_consumer::getThreadPolicyResult() const {
+    std::lock_guard<std::mutex> lock(thread_result_lock);
+    return thread_result;
+}
+
+void usb_audio_consumer::setCapture(audio_capture_writer* writer) {
+    if (running.load()) {
+        LOG_ERROR("Cannot change consumer capture while streaming");
+        return;
+    }
+    capture = writer;
+    std::fill(capture_sequence.begin(), capture_sequence.end(), 0);
+}
+
+void usb_audio_consumer::captureLanes(const std::vector<lane_read>& lanes, size_t frameSize, int64_t readTimeNs) {
+    const size_t bytesPerFrame = format.getBytesPerFrame();
+    for (size_t lane = 0; lane < lanes.size(); ++lane) {
+        const lane_read& read = lanes[lane];
+        for (size_t frame = 0; frame < read.frames; ++frame) {
+            const uint8_t* slot = static_cast<const uint8_t*>(read.buffer) + frame * frameSize;
+            audio_capture_record_header record;
+            record.read_time_ns = readTimeNs;
+            record.payload_bytes = static_cast<uint32_t>(read.packet_frames[frame] * bytesPerFrame);
+            record.lane = static_cast<uint16_t>(lane);
+            if (read.ring->hasFrameMeta()) {
+                const audio_frame_meta* meta = read.ring->getFrameMeta(slot);
+                record.sequence = meta->sequence;
+                record.commit_time_ns = meta->timestamp_ns;
+                record.flags = audio_capture_record_header::FLAG_FRAME_META;
+            } else {
+                record.sequence = capture_sequence[lane];
+                record.commit_time_ns = readTimeNs;
+                record.flags = 0;
+            }
+            ++capture_sequence[lane];
+            capture->append(record, slot);
+        }
+    }
+}
+
+void usb_audio_consumer::readPacketSizes(size_t lane, lane_read& read, size_t frameSize) {
+    const size_t bytesPerFrame = format.getBytesPerFrame();
+    const size_t maxFrames = mix_buffer.size() / format.channels;
+    // Only a live resize to a larger ring can outgrow the initial allocation
+    if (read.frames > read.packet_frames.size()) {
+        read.packet_frames.resize(read.frames);
+    }
+    for (size_t frame = 0; frame < read.frames; ++frame) {
+        size_t frames;
+        if (read.ring->hasFrameMeta()) {
+            frames = read.ring->getFrameMeta(static_cast<uint8_t*>(read.buffer) + frame * frameSize)->payload_bytes / bytesPerFrame;
+        } else {
+            frames = lane_packets[lane].next();
+        }
+        read.packet_frames[frame] = static_cast<uint32_t>(std::min(frames, maxFrames));
+    }
+}
+
+void usb_audio_consumer::mixLanes(const std::vector<lane_read>& lanes, size_t frames, size_t frameSize) {
+    // Only each packet is decoded; the rest of the slot carries no samples,
+    // and a lane with a shorter packet contributes silence past its end
+    for (size_t frame = 0; frame < frames; ++frame) {
+        std::fill(mix_buffer.begin(), mix_buffer.end(), 0.0f);
+        for (size_t lane = 0; lane < lanes.size(); ++lane) {
+            if (lanes[lane].frames <= frame) continue;
+            const uint8_t* slot = static_cast<const uint8_t*>(lanes[lane].buffer) + frame * frameSize;
+            const size_t samples = lanes[lane].packet_frames[frame] * format.channels;
+            audio_convert_to_float(slot, decode_buffer.data(), samples, format);
+            for (size_t i = 0; i < samples; ++i) {
+                mix_buffer[i] += decode_buffer[i];
+            }
+        }
+    }
+}
+
 void usb_audio_consumer::consumerLoop() {
-    ma_rb* ring_buffer = buffer_controller->getRingBuffer();
-    if (!ring_buffer) {
+    // One lane per producer; a plain controller has exactly one
+    std::vector<lane_read> lanes(buffer_controller->getProducerLaneCount());
+    for (size_t lane = 0; lane < lanes.size(); ++lane) {
+        lanes[lane].ring = buffer_controller->getReadRing(lane);
+        if (!lanes[lane].ring) {
+            LOG_ERROR("Consumer cannot start - no ring buffer available");
+            return;
+        }
+    }
+    if (lanes.empty() || lane_latency.size() != lanes.size()) {
         LOG_ERROR("Consumer cannot start - no ring buffer available");
         return;
     }
 
-    auto microframeStart = std::chrono::high_resolution_clock::now();
+    // One microframe slot per 125μs; slots are whole so a read is never split
+    const size_t frameSize = lanes[0].ring->getFrameSize();
+    audio_fill_telemetry& fillTelemetry = buffer_controller->getFillTelemetry();
+    // Whole sample frames of the payload that fit in a slot
+    const size_t payloadSamples = std::min(format.getSamplesPerMicroframe(),
+                                           frameSize / format.getBytesPerFrame() * format.channels);
+    mix_buffer.assign(payloadSamples, 0.0f);
+    decode_buffer.assign(payloadSamples, 0.0f);
+    for (size_t lane = 0; lane < lanes.size(); ++lane) {
+        lanes[lane].packet_frames.assign(lanes[lane].ring->getFrameCount(), 0);
+    }
+    
+    audio_thread_policy_result policyResult = audio_apply_thread_policy(thread_policy, "Consumer");
+    {
+        std::lock_guard<std::mutex> lock(thread_result_lock);
+        thread_result = policyResult;
+    }
+    
+    // Faults from here on are taken on the real-time path
+    audio_page_faults loopStartFaults = audio_ring_memory::getThreadPageFaults();
+    
+    // Deadlines are absolute from the stream start, so sleep error never accumulates
+    timer.prepareThread();
+    const int64_t microframeNs = 125000;
+    int64_t nextMicroframeNs = audio_steady_time_ns() + microframeNs;
     uint64_t microframeCount = 0;
+    uint64_t nextStatusAt = 0;
+    bool producerLost = false;
     
     while (running.load()) {
-        // Calculate next microframe consumption time
-        auto nextMicroframe = microframeStart + std::chrono::microseconds(125);
-        
         // Wait until USB consumption time
-        std::this_thread::sleep_until(nextMicroframe);
+        int64_t latenessNs = timer.sleepUntil(nextMicroframeNs);
+        
+        // A late wake-up means several microframes are due; take them in one batch
+        // instead of one acquire/commit per slot
+        size_t framesDue = 1;
+        if (latenessNs >= microframeNs) {
+            framesDue += static_cast<size_t>(latenessNs / microframeNs);
+            trace.record(audio_trace_type::late_wakeup, static_cast<uint64_t>(latenessNs), framesDue);
+        }
         
-        // USB CONSUMES: 384 bytes every 125μs
-        size_t bytesToConsume = 384;
-        void* readBuffer;
-        size_t bytesAcquired = bytesToConsume;
+        buffer_controller->heartbeat();
         
-        ma_result result = ma_rb_acquire_read(ring_buffer, &bytesAcquired, &readBuffer);
+        // Sample the fill level the USB side sees at each read (the emptiest lane in fan-in mode)
+        size_t fillFrames = lanes[0].ring->availableRead() / frameSize;
+        for (size_t lane = 1; lane < lanes.size(); ++lane) {
+            fillFrames = std::min(fillFrames, lanes[lane].ring->availableRead() / frameSize);
+        }
+        fillTelemetry.record(fillFrames);
         
-        // Performance monitoring: Log every 1000th microframe
-        if (microframeCount % 1000 == 0) {
-            auto now = std::chrono::high_resolution_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
-                now - microframeStart).count();
-            auto expectedTime = microframeCount * 125;
-            auto timingError = (elapsed > static_cast<int64_t>(expectedTime)) ? 
-                              (elapsed - static_cast<int64_t>(expectedTime)) : 
-                              (static_cast<int64_t>(expectedTime) - elapsed);
+        // A non-mirrored ring hands out at most the slots up to its wrap point, so keep
+        // reading until every due microframe is in or the lanes run dry
+        size_t framesAcquired = 0;
+        uint64_t samplesRead = 0;
+        while (framesAcquired < framesDue) {
+            // Each pass is one span of microframes for every lane (the longest lane sets its length)
+            const size_t wanted = framesDue - framesAcquired;
+            size_t passFrames = 0;
+            for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                lane_read& read = lanes[lane];
+                read.frames = wanted;
+                ma_result result = read.ring->acquireReadFrames(&read.frames, &read.buffer);
+                if (lane == 0 && result == MA_SUCCESS && read.frames == 0) {
+                    // Old ring drained after a live resize: follow the producer to the new one
+                    audio_frame_ring* nextRing = buffer_controller->syncReadRing(read.ring);
+                    if (nextRing != read.ring) {
+                        read.ring = nextRing;
+                        read.frames = wanted;
+                        result = read.ring->acquireReadFrames(&read.frames, &read.buffer);
+                    }
+                }
+                if (result != MA_SUCCESS) {
+                    read.frames = 0;
+                }
+                passFrames = std::max(passFrames, read.frames);
+            }
+            if (passFrames == 0) break;
+            
+            // Queueing latency and sequence continuity for every frame read
+            int64_t readTimeNs = audio_steady_time_ns();
+            for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                const lane_read& read = lanes[lane];
+                if (read.frames == 0 || !read.ring->hasFrameMeta()) continue;
+                for (size_t frame = 0; frame < read.frames; ++frame) {
+                    const audio_frame_meta* meta = read.ring->getFrameMeta(
+                        static_cast<uint8_t*>(read.buffer) + frame * frameSize);
+                    lane_latency[lane]->record(meta->sequence, readTimeNs - meta->timestamp_ns);
+                }
+            }
+            
+            // Packet lengths, then the sample frames delivered: the longest packet
+            // in each microframe when lanes are mixed
+            for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                readPacketSizes(lane, lanes[lane], frameSize);
+            }
+            for (size_t frame = 0; frame < passFrames; ++frame) {
+                uint32_t longest = 0;
+                for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                    if (lanes[lane].frames > frame) longest = std::max(longest, lanes[lane].packet_frames[frame]);
+                }
+                samplesRead += longest;
+            }
+            
+            // Capture copies each packet into the writer's staging ring before the slots are released
+            if (capture) {
+                captureLanes(lanes, frameSize, readTimeNs);
+            }
+            
+            // Fan-in: merge the lanes straight from the slots, then release them
+            if (lanes.size() > 1) {
+                mixLanes(lanes, passFrames, frameSize);
+            }
             
-            LOG_INFO("USB microframe #" + std::to_string(microframeCount) + 
-                     " - Timing error: " + std::to_string(timingError) + "μs" +
-                     " - Underruns: " + std::to_string(underrun_count.load()));
+            // One commit per lane per contiguous piece
+            for (size_t lane = 0; lane < lanes.size(); ++lane) {
+                if (lanes[lane].frames > 0) {
+                    lanes[lane].ring->commitReadFrames(lanes[lane].frames);
+                }
+            }
+            framesAcquired += passFrames;
         }
         
-        if (result == MA_SUCCESS && bytesAcquired == 384) {
-            // USB successfully consumed microframe
-            ma_rb_commit_read(ring_buffer, bytesAcquired);
-            total_frames_consumed.fetch_add(1);
-        } else {
-            // USB underrun - no data available
-            underrun_count.fetch_add(1);
-            LOG_WARN("USB underrun: expected 384 bytes, got " + std::to_string(bytesAcquired));
+        if (framesAcquired > 0) {
+            total_samples_consumed.fetch_add(samplesRead, std::memory_order_relaxed);
+            total_frames_consumed.fetch_add(static_cast<uint32_t>(framesAcquired));
+            if (trace.tracesCommits()) {
+                trace.record(audio_trace_type::commit, microframeCount, framesAcquired, samplesRead);
+            }
+        }
+        
+        // Only an empty ring pays for the peer check; a live ring proves the producer is there
+        if (framesAcquired == 0 && !producerLost && buffer_controller->isPeerGone()) {
+            producerLost = true;
+            trace.record(audio_trace_type::producer_lost, microframeCount);
+        } else if (framesAcquired > 0 && producerLost) {
+            producerLost = false;
+            trace.record(audio_trace_type::producer_back, microframeCount);
+        }
+        
+        // Performance monitoring: roughly every 1000th microframe, the tail of the interval since the
+        // last status; the drain thread turns it into text
+        if (microframeCount >= nextStatusAt) {
+            audio_latency_snapshot wakeups = timer.takeLatenessInterval();
+            audio_latency_snapshot queueing = audio_latency_snapshot();
+            for (size_t lane = 0; lane < lane_latency.size(); ++lane) {
+                queueing.merge(lane_latency[lane]->takeInterval());
+            }
+            trace.record(audio_trace_type::status, microframeCount, underrun_count.load(),
+                         wakeups.percentileNs(99.0), wakeups.maxNs,
+                         queueing.samples > 0 ? queueing.percentileNs(99.0) : 0, queueing.maxNs);
+            nextStatusAt = microframeCount + 1000;
+        }
+        
+        if (framesAcquired < framesDue) {
+            // USB underrun - every due microframe the ring could not supply is one underrun
+            underrun_count.fetch_add(static_cast<uint32_t>(framesDue - framesAcquired));
+            trace.record(audio_trace_type::underrun, framesDue, framesAcquired, microframeCount);
         }
         
-        microframeStart = nextMicroframe;
-        microframeCount++;
+        nextMicroframeNs += microframeNs * static_cast<int64_t>(framesDue);
+        microframeCount += framesDue;
     }
+    
+    audio_page_faults loopEndFaults = audio_ring_memory::getThreadPageFaults();
+    page_fault_count.store((loopEndFaults.minor - loopStartFaults.minor) + 
+                           (loopEndFaults.major - loopStartFaults.major));
 }
 
 
@@ -1,19 +1,36 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 #include "iaudio_consumer.h"
+#include "audio_sample_format.h"
+#include "audio_packet_scheduler.h"
+#include "audio_precise_timer.h"
+#include "audio_trace.h"
 
 // Forward declaration
 namespace kcobain {
     class audio_rb_controller;
+    class audio_frame_ring;
+    class audio_capture_writer;
 }
 
 namespace kcobain {
 
 /**
  * @brief USB Audio Consumer Implementation
- * Reads audio data from the ring buffer and processes it
+ * Reads audio data from the ring buffer and processes it. With a fan-in
+ * controller it reads every producer lane each microframe and mixes them;
+ * a lane with no data contributes silence. Lanes are decoded from the
+ * microframe format to float before they are summed. Packet lengths come
+ * from the slot metadata, or from the same schedule the producer follows
+ * when the ring carries none. Microframe deadlines are absolute on the
+ * monotonic clock and waited out by a hybrid sleep/spin timer. With a capture attached every packet read
+ * is also staged for the capture writer. The streaming loop never logs: underruns, late wake-ups and the
+ * periodic status go to a binary trace ring that a background drain formats.
  */
 class usb_audio_consumer : public iaudio_consumer {
 private:
@@ -22,19 +39,54 @@ private:
     std::thread consumer_thread;
     std::atomic<uint32_t> total_frames_consumed;
     std::atomic<uint32_t> underrun_count;
+    std::atomic<uint64_t> total_samples_consumed;
+    std::atomic<uint64_t> page_fault_count;  // Faults taken inside the streaming loop
+    std::vector<std::unique_ptr<audio_latency_telemetry> > lane_latency;  // Queueing latency and sequence gaps per lane
+    audio_microframe_format format;          // Wire format of the payload
+    std::vector<float> mix_buffer;           // One mixed microframe (fan-in mode)
+    std::vector<float> decode_buffer;        // One lane's microframe as float
+    std::vector<audio_packet_scheduler> lane_packets;  // Packet lengths for rings without metadata
+    audio_precise_timer timer;               // 125μs cadence; records every wake-up's lateness
+    audio_capture_writer* capture;           // Records every packet read (not owned, may be null)
+    std::vector<uint64_t> capture_sequence;  // Per-lane count for rings without metadata
+    audio_thread_policy thread_policy;       // Scheduling, affinity and stack prefault for consumer_thread
+    audio_thread_policy_result thread_result;
+    mutable std::mutex thread_result_lock;   // thread_result is written by consumer_thread
+    audio_trace_ring trace;                  // Events recorded by consumer_thread, formatted by the shared drain
+    
+    struct lane_read {
+        audio_frame_ring* ring;
+        void* buffer;
+        size_t frames;                          // Slots in the current contiguous piece
+        std::vector<uint32_t> packet_frames;   // Sample frames in each acquired slot
+    };
 
 public:
-    usb_audio_consumer(audio_rb_controller* controller);
+    usb_audio_consumer(audio_rb_controller* controller,
+                       const audio_microframe_format& microframeFormat = audio_microframe_format(),
+                       const audio_timer_config& timerConfig = audio_timer_config(),
+                       const audio_trace_config& traceConfig = audio_trace_config());
     ~usb_audio_consumer();
     
     void start() override;
     void stop() override;
     bool isRunning() const override;
     uint32_t getTotalFramesConsumed() const override;
+    uint64_t getTotalSamplesConsumed() const override;
     uint32_t getUnderrunCount() const override;
+    uint64_t getPageFaultCount() const override;
+    audio_latency_snapshot getLatencySnapshot() const override;
+    audio_latency_snapshot getWakeupLateness() const override;
+    uint64_t getWakeupOversleeps() const override;
+    void setCapture(audio_capture_writer* writer) override;
+    void setThreadPolicy(const audio_thread_policy& policy) override;
+    audio_thread_policy_result getThreadPolicyResult() const override;
 
 private:
     void consumerLoop();
+    void readPacketSizes(size_t lane, lane_read& read, size_t frameSize);
+    void captureLanes(const std::vector<lane_read>& lanes, size_t frameSize, int64_t readTimeNs);
+    void mixLanes(const std::vector<lane_read>& lanes, size_t frames, size_t frameSize);
 };
 
 } // namespace kcobain 
\ No newline at end of file
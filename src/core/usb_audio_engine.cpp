@@ -0,0 +1,336 @@
+#include "usb_audio_engine.h"
+#include "../../include/kcobain/logger.h"
+#include "../../external/miniaudio.h"
+#include <algorithm>
+
+namespace kcobain {
+
+const int64_t usb_audio_engine::MICROFRAME_NS;
+
+usb_audio_engine::usb_audio_engine(const usb_audio_engine_config& engineConfig)
+    : config(engineConfig), running(false) {
+    if (config.threads == 0) config.threads = 1;
+    if (config.tickNs <= 0) config.tickNs = MICROFRAME_NS / 8;
+    if (config.wheelSlots == 0) config.wheelSlots = 512;
+}
+
+usb_audio_engine::~usb_audio_engine() {
+    stop();
+}
+
+int usb_audio_engine::addEndpoint(const usb_audio_endpoint_config& endpointConfig) {
+    if (running.load()) {
+        LOG_ERROR("Cannot add an endpoint while the engine is running");
+        return -1;
+    }
+
+    std::unique_ptr<endpoint> ep(new endpoint());
+    ep->config = endpointConfig;
+    usb_audio_endpoint_config& cfg = ep->config;
+    if (!cfg.format.isValid()) {
+        LOG_ERROR("Cannot add endpoint - invalid microframe format (" + cfg.format.describe() + ")");
+        return -1;
+    }
+    if (cfg.producerPeriodFrames == 0) cfg.producerPeriodFrames = 1;
+
+    // Engine endpoints are single lane and in-process; the producer and consumer share a thread
+    cfg.ringConfig.producerLanes = 1;
+    cfg.ringConfig.sharedName.clear();
+    if (!ep->controller.initialize(cfg.ringFrames * cfg.ringConfig.frameSize, cfg.ringConfig)) {
+        LOG_ERROR("Cannot add endpoint - ring initialization failed");
+        return -1;
+    }
+
+    size_t capacity = ep->controller.getFrameCapacity();
+    if (cfg.targetFillFrames == 0 || cfg.targetFillFrames > capacity) {
+        cfg.targetFillFrames = static_cast<uint32_t>(std::min<size_t>(capacity, cfg.producerPeriodFrames * 2));
+        LOG_WARN("Endpoint fill target set to " + std::to_string(cfg.targetFillFrames) + " microframes");
+    }
+    if (cfg.targetFillFrames <= cfg.producerPeriodFrames) {
+        LOG_WARN("Endpoint fill target " + std::to_string(cfg.targetFillFrames) + " does not cover the " +
+                 std::to_string(cfg.producerPeriodFrames) + "-microframe producer period - expect underruns");
+    }
+
+    ep->payload_bytes = cfg.format.getPayloadBytes();
+    if (ep->payload_bytes > cfg.ringConfig.frameSize) {
+        LOG_ERROR("Endpoint payload " + std::to_string(ep->payload_bytes) + " bytes does not fit a " +
+                  std::to_string(cfg.ringConfig.frameSize) + "-byte slot - packets will be truncated");
+        ep->payload_bytes = cfg.ringConfig.frameSize;
+    }
+
+    cfg.signalConfig.sampleRate = cfg.format.sampleRate;
+    cfg.signalConfig.channels = cfg.format.channels;
+    if (!ep->generator.initialize(cfg.signalConfig)) {
+        return -1;
+    }
+    ep->source = &ep->generator;
+    ep->packer.initialize(cfg.format, cfg.targetFillFrames);
+    ep->consumer_packets.initialize(cfg.format);
+
+    uint32_t index = static_cast<uint32_t>(endpoints.size());
+    ep->producer_timer.owner = index;
+    ep->producer_timer.kind = PRODUCER_EVENT;
+    ep->consumer_timer.owner = index;
+    ep->consumer_timer.kind = CONSUMER_EVENT;
+    endpoints.push_back(std::move(ep));
+    return static_cast<int>(index);
+}
+
+bool usb_audio_engine::setSource(size_t endpointIndex, iaudio_source* source) {
+    if (endpointIndex >= endpoints.size()) {
+        LOG_ERROR("Cannot set source - no endpoint " + std::to_string(endpointIndex));
+        return false;
+    }
+    if (running.load()) {
+        LOG_ERROR("Cannot set source while the engine is running");
+        return false;
+    }
+    endpoint& ep = *endpoints[endpointIndex];
+    if (!ep.packer.accepts(source)) {
+        LOG_ERROR("Cannot set source on endpoint " + std::to_string(endpointIndex));
+        return false;
+    }
+    ep.source = source ? source : &ep.generator;
+    return true;
+}
+
+size_t usb_audio_engine::getEndpointCount() const {
+    return endpoints.size();
+}
+
+bool usb_audio_engine::start() {
+    if (running.load()) return true;
+    if (endpoints.empty()) {
+        LOG_ERROR("Cannot start engine - no endpoints");
+        return false;
+    }
+
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        if (!endpoints[i]->source->start()) {
+            LOG_ERROR("Cannot start engine - source of endpoint " + std::to_string(i) + " failed to start");
+            for (size_t j = 0; j < i; ++j) endpoints[j]->source->stop();
+            return false;
+        }
+    }
+
+    // Never more workers than endpoints
+    size_t threadCount = std::min(config.threads, endpoints.size());
+    workers.clear();
+    for (size_t t = 0; t < threadCount; ++t) {
+        workers.push_back(std::unique_ptr<worker>(new worker(config.timerConfig)));
+    }
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        workers[i % threadCount]->endpoints.push_back(i);
+    }
+
+    running = true;
+    for (size_t t = 0; t < workers.size(); ++t) {
+        worker* pWorker = workers[t].get();
+        pWorker->thread = std::thread([this, pWorker]() { workerLoop(pWorker); });
+    }
+
+    LOG_INFO("🚀 USB audio engine: " + std::to_string(endpoints.size()) + " endpoints on " +
+             std::to_string(workers.size()) + " thread(s), " + std::to_string(config.tickNs) + "ns wheel ticks");
+    return true;
+}
+
+void usb_audio_engine::stop() {
+    if (!running.load()) return;
+
+    running = false;
+    for (size_t t = 0; t < workers.size(); ++t) {
+        if (workers[t]->thread.joinable()) {
+            workers[t]->thread.join();
+        }
+    }
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        endpoints[i]->source->stop();
+    }
+    LOG_INFO("🛑 USB audio engine stopped");
+}
+
+bool usb_audio_engine::isRunning() const {
+    return running.load();
+}
+
+void usb_audio_engine::serviceProducer(endpoint& ep, int64_t nowNs) {
+    audio_frame_ring* ring = ep.controller.getWriteRing(0);
+    const size_t slotSize = ring->getFrameSize();
+    size_t fill = ring->availableRead() / slotSize;
+
+    // Top up to the setpoint; a non-mirrored ring may hand it out in two pieces
+    while (fill < ep.config.targetFillFrames) {
+        size_t frames = ep.config.targetFillFrames - fill;
+        void* slots = nullptr;
+        if (ring->acquireWriteFrames(&frames, &slots) != MA_SUCCESS || frames == 0) break;
+
+        ep.packer.pack(ep.source, static_cast<uint8_t*>(slots), frames, slotSize, ep.payload_bytes);
+        if (ring->hasFrameMeta()) {
+            int64_t commitTimeNs = audio_steady_time_ns();
+            for (size_t frame = 0; frame < frames; ++frame) {
+                audio_frame_meta* meta = ring->getFrameMeta(static_cast<uint8_t*>(slots) + frame * slotSize);
+                meta->sequence = ep.sequence++;
+                meta->timestamp_ns = commitTimeNs;
+                meta->payload_bytes = ep.packer.getPacketBytes(frame);
+            }
+        }
+        ring->commitWriteFrames(frames);
+        ep.produced.fetch_add(frames, std::memory_order_relaxed);
+        fill += frames;
+    }
+
+    // A stalled worker resyncs instead of running a burst of back-to-back top-ups
+    const int64_t periodNs = static_cast<int64_t>(ep.config.producerPeriodFrames) * MICROFRAME_NS;
+    ep.producer_timer.deadline_ns += periodNs;
+    if (ep.producer_timer.deadline_ns <= nowNs) {
+        ep.producer_timer.deadline_ns = nowNs + periodNs;
+    }
+}
+
+void usb_audio_engine::serviceConsumer(endpoint& ep, worker& w, int64_t nowNs) {
+    // A late service catches up every due microframe in one read, as usb_audio_consumer does
+    int64_t lateness = std::max<int64_t>(nowNs - ep.consumer_timer.deadline_ns, 0);
+    size_t framesDue = 1 + static_cast<size_t>(lateness / MICROFRAME_NS);
+
+    w.consumer_events.fetch_add(1, std::memory_order_relaxed);
+    w.lateness_total_ns.fetch_add(static_cast<uint64_t>(lateness), std::memory_order_relaxed);
+    if (lateness > w.lateness_max_ns.load(std::memory_order_relaxed)) {
+        w.lateness_max_ns.store(lateness, std::memory_order_relaxed);
+    }
+    if (framesDue > 1) {
+        w.late_events.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    audio_frame_ring* ring = ep.controller.getReadRing(0);
+    const size_t slotSize = ring->getFrameSize();
+    const size_t bytesPerFrame = ep.config.format.getBytesPerFrame();
+
+    // A non-mirrored ring may hand the due microframes out in two pieces
+    size_t framesRead = 0;
+    uint64_t samplesRead = 0;
+    while (framesRead < framesDue) {
+        size_t frames = framesDue - framesRead;
+        void* slots = nullptr;
+        if (ring->acquireReadFrames(&frames, &slots) != MA_SUCCESS || frames == 0) break;
+
+        for (size_t frame = 0; frame < frames; ++frame) {
+            if (ring->hasFrameMeta()) {
+                samplesRead += ring->getFrameMeta(static_cast<uint8_t*>(slots) + frame * slotSize)->payload_bytes / bytesPerFrame;
+            } else {
+                samplesRead += ep.consumer_packets.next();
+            }
+        }
+        ring->commitReadFrames(frames);
+        framesRead += frames;
+    }
+    if (framesRead > 0) {
+        ep.consumed.fetch_add(framesRead, std::memory_order_relaxed);
+        ep.samples.fetch_add(samplesRead, std::memory_order_relaxed);
+    }
+    if (framesRead < framesDue) {
+        ep.underruns.fetch_add(framesDue - framesRead, std::memory_order_relaxed);
+    }
+
+    ep.consumer_timer.deadline_ns += static_cast<int64_t>(framesDue) * MICROFRAME_NS;
+}
+
+void usb_audio_engine::workerLoop(worker* pWorker) {
+    worker& w = *pWorker;
+    const int64_t startNs = audio_steady_time_ns();
+    w.wheel.initialize(config.wheelSlots, config.tickNs, startNs);
+    audio_apply_thread_policy(config.threadPolicy, "Engine worker");
+    w.timer.prepareThread();
+
+    // Consumers share the bus start of frame; producers are spread across their
+    // period, half a microframe off the consumer edge, so their work does not pile up
+    for (size_t i = 0; i < w.endpoints.size(); ++i) {
+        endpoint& ep = *endpoints[w.endpoints[i]];
+        serviceProducer(ep, startNs);     // Prime to the setpoint before the first read
+        ep.producer_timer.deadline_ns = startNs + MICROFRAME_NS / 2 +
+                                        static_cast<int64_t>(i % ep.config.producerPeriodFrames) * MICROFRAME_NS;
+        ep.consumer_timer.deadline_ns = startNs + MICROFRAME_NS;
+        w.wheel.schedule(&ep.producer_timer);
+        w.wheel.schedule(&ep.consumer_timer);
+    }
+
+    while (running.load(std::memory_order_relaxed)) {
+        int64_t nextNs = w.wheel.nextDeadline();
+        if (nextNs < 0) break;
+        w.timer.sleepUntil(nextNs);
+
+        int64_t nowNs = audio_steady_time_ns();
+        audio_timer_node* node = w.wheel.expire(nowNs);
+        if (node) {
+            w.wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+        while (node) {
+            audio_timer_node* next = node->next;
+            endpoint& ep = *endpoints[node->owner];
+            if (node->kind == CONSUMER_EVENT) {
+                serviceConsumer(ep, w, nowNs);
+            } else {
+                serviceProducer(ep, nowNs);
+            }
+            w.events.fetch_add(1, std::memory_order_relaxed);
+            w.wheel.schedule(node);
+            node = next;
+        }
+    }
+}
+
+usb_audio_endpoint_stats usb_audio_engine::getEndpointStats(size_t endpointIndex) const {
+    usb_audio_endpoint_stats stats;
+    if (endpointIndex >= endpoints.size()) return stats;
+    const endpoint& ep = *endpoints[endpointIndex];
+    stats.produced = ep.produced.load();
+    stats.consumed = ep.consumed.load();
+    stats.samples = ep.samples.load();
+    stats.underruns = ep.underruns.load();
+    return stats;
+}
+
+usb_audio_engine_stats usb_audio_engine::getStats() const {
+    usb_audio_engine_stats stats;
+    stats.endpoints = endpoints.size();
+    stats.threads = workers.size();
+    for (size_t t = 0; t < workers.size(); ++t) {
+        const worker& w = *workers[t];
+        stats.events += w.events.load();
+        stats.consumerEvents += w.consumer_events.load();
+        stats.lateEvents += w.late_events.load();
+        stats.totalLatenessNs += w.lateness_total_ns.load();
+        stats.maxLatenessNs = std::max(stats.maxLatenessNs, w.lateness_max_ns.load());
+        stats.wakeups += w.wakeups.load();
+    }
+    return stats;
+}
+
+void usb_audio_engine::printStatistics() const {
+    LOG_INFO("=== USB Audio Engine Statistics ===");
+
+    usb_audio_engine_stats stats = getStats();
+    LOG_INFO("Endpoints: " + std::to_string(stats.endpoints) + " on " + std::to_string(stats.threads) + " thread(s)");
+    LOG_INFO("Timer Events: " + std::to_string(stats.events) + " in " + std::to_string(stats.wakeups) + " wake-ups");
+    if (stats.consumerEvents > 0) {
+        LOG_INFO("Consumer Lateness: avg " + std::to_string(stats.totalLatenessNs / stats.consumerEvents / 1000) +
+                 "μs, max " + std::to_string(stats.maxLatenessNs / 1000) + "μs, " + std::to_string(stats.lateEvents) +
+                 " of " + std::to_string(stats.consumerEvents) + " events a microframe or more late");
+    }
+
+    usb_audio_endpoint_stats total;
+    uint64_t worstUnderruns = 0;
+    for (size_t i = 0; i < endpoints.size(); ++i) {
+        usb_audio_endpoint_stats ep = getEndpointStats(i);
+        total.produced += ep.produced;
+        total.consumed += ep.consumed;
+        total.samples += ep.samples;
+        total.underruns += ep.underruns;
+        worstUnderruns = std::max(worstUnderruns, ep.underruns);
+    }
+    LOG_INFO("Total Frames Produced: " + std::to_string(total.produced));
+    LOG_INFO("Total Frames Consumed: " + std::to_string(total.consumed) + " (" + std::to_string(total.samples) +
+             " sample frames)");
+    LOG_INFO("Underruns: " + std::to_string(total.underruns) + " (worst endpoint " + std::to_string(worstUnderruns) + ")");
+}
+
+} // namespace kcobain
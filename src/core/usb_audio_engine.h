@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "audio_rb_controller.h"
+#include "audio_signal_generator.h"
+#include "audio_microframe_packer.h"
+#include "audio_timer_wheel.h"
+#include "audio_precise_timer.h"
+#include "audio_thread_policy.h"
+#include "iaudio_source.h"
+
+namespace kcobain {
+
+/**
+ * @brief One simulated USB endpoint driven by the engine
+ * The producer side tops the ring up to targetFillFrames every
+ * producerPeriodFrames microframes; the consumer side drains one
+ * microframe every 125μs, as usb_audio_consumer does.
+ */
+struct usb_audio_endpoint_config {
+    audio_microframe_format format;
+    audio_signal_config signalConfig;   // Rate and channels follow the format
+    audio_rb_config ringConfig;         // Slot size and backing (one lane, in-process)
+    size_t ringFrames;                  // Ring capacity in microframes
+    uint32_t targetFillFrames;          // Fill the producer restores at each service
+    uint32_t producerPeriodFrames;      // Microframes between producer services
+
+    usb_audio_endpoint_config() : ringFrames(80), targetFillFrames(16), producerPeriodFrames(8) {}
+};
+
+/**
+ * @brief Engine configuration
+ */
+struct usb_audio_engine_config {
+    size_t threads;             // Worker threads; endpoints are spread across them round-robin
+    int64_t tickNs;             // Timer wheel resolution
+    size_t wheelSlots;          // Wheel size; slots × tick is the horizon covered without re-rounds
+    audio_timer_config timerConfig;  // How workers wait for the next deadline
+    audio_thread_policy threadPolicy;   // Applied by every worker when it starts
+
+    usb_audio_engine_config() : threads(1), tickNs(15625), wheelSlots(512) {
+        // A worker rarely sleeps a whole microframe; spinning is opt-in here
+        timerConfig.spinMarginMicros = 0;
+    }
+};
+
+/**
+ * @brief Per-endpoint counters
+ */
+struct usb_audio_endpoint_stats {
+    uint64_t produced;          // Microframes written
+    uint64_t consumed;          // Microframes read on time or caught up
+    uint64_t samples;           // Sample frames consumed
+    uint64_t underruns;         // Due microframes with no data
+
+    usb_audio_endpoint_stats() : produced(0), consumed(0), samples(0), underruns(0) {}
+};
+
+/**
+ * @brief Scheduling figures summed over the workers
+ * Lateness is service time minus deadline for consumer events; an event
+ * a whole microframe late is caught up in one batched read.
+ */
+struct usb_audio_engine_stats {
+    size_t endpoints;
+    size_t threads;
+    uint64_t events;            // Timer events serviced (producer and consumer)
+    uint64_t consumerEvents;
+    uint64_t lateEvents;        // Consumer events at least one microframe late
+    uint64_t totalLatenessNs;
+    int64_t maxLatenessNs;
+    uint64_t wakeups;           // Worker sleeps that ended in at least one event
+
+    usb_audio_engine_stats()
+        : endpoints(0), threads(0), events(0), consumerEvents(0), lateEvents(0), totalLatenessNs(0), maxLatenessNs(0),
+          wakeups(0) {}
+};
+
+/**
+ * @brief Runs many simulated USB endpoints from one thread or a small pool
+ * Instead of a producer thread and a consumer thread per endpoint, every
+ * endpoint's microframe events sit on the worker's timer wheel. A worker
+ * sleeps until the earliest deadline, services every event that is due in
+ * deadline order, and reschedules them; nothing blocks, so a full ring just
+ * means no production that round. Endpoints own their rings and packers,
+ * and servicing them does not allocate.
+ */
+class usb_audio_engine {
+private:
+    static const int64_t MICROFRAME_NS = 125000;
+
+    enum timer_kind : uint32_t {
+        PRODUCER_EVENT = 0,
+        CONSUMER_EVENT = 1
+    };
+
+    struct endpoint {
+        usb_audio_endpoint_config config;
+        audio_rb_controller controller;
+        audio_signal_generator generator;
+        iaudio_source* source;                  // Not owned; defaults to the generator
+        audio_microframe_packer packer;
+        audio_packet_scheduler consumer_packets;  // Packet lengths when the ring has no metadata
+        audio_timer_node producer_timer;
+        audio_timer_node consumer_timer;
+        size_t payload_bytes;
+        uint64_t sequence;
+        std::atomic<uint64_t> produced;
+        std::atomic<uint64_t> consumed;
+        std::atomic<uint64_t> samples;
+        std::atomic<uint64_t> underruns;
+
+        endpoint() : source(nullptr), payload_bytes(0), sequence(0), produced(0), consumed(0), samples(0), underruns(0) {}
+    };
+
+    struct worker {
+        std::thread thread;
+        audio_timer_wheel wheel;
+        audio_precise_timer timer;
+        std::vector<size_t> endpoints;
+        std::atomic<uint64_t> events;
+        std::atomic<uint64_t> consumer_events;
+        std::atomic<uint64_t> late_events;
+        std::atomic<uint64_t> lateness_total_ns;
+        std::atomic<int64_t> lateness_max_ns;
+        std::atomic<uint64_t> wakeups;
+
+        explicit worker(const audio_timer_config& timerConfig)
+            : timer(timerConfig), events(0), consumer_events(0), late_events(0), lateness_total_ns(0), lateness_max_ns(0), wakeups(0) {}
+    };
+
+    usb_audio_engine_config config;
+    std::vector<std::unique_ptr<endpoint> > endpoints;
+    std::vector<std::unique_ptr<worker> > workers;
+    std::atomic<bool> running;
+
+    void workerLoop(worker* pWorker);
+    void serviceProducer(endpoint& ep, int64_t nowNs);
+    void serviceConsumer(endpoint& ep, worker& w, int64_t nowNs);
+
+public:
+    explicit usb_audio_engine(const usb_audio_engine_config& engineConfig = usb_audio_engine_config());
+    ~usb_audio_engine();
+
+    // Endpoints are added while stopped; returns the endpoint index, or -1
+    int addEndpoint(const usb_audio_endpoint_config& endpointConfig);
+    // Feed an endpoint from an external source; null restores its test signal
+    bool setSource(size_t endpointIndex, iaudio_source* source);
+    size_t getEndpointCount() const;
+
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+    usb_audio_endpoint_stats getEndpointStats(size_t endpointIndex) const;
+    usb_audio_engine_stats getStats() const;
+    void printStatistics() const;
+};
+
+} // namespace kcobain
@@ -2,71 +2,285 @@
 #include "usb_audio_producer.h"
 #include "usb_audio_consumer.h"
 #include "../../include/kcobain/logger.h"
+#include "../../include/kcobain/alloc_counter.h"
 
 namespace kcobain {
 
-usb_audio_orchestrator::usb_audio_orchestrator(audio_rb_controller* controller, size_t frameSize)
-    : buffer_controller(controller), frame_size(frameSize) {
+usb_audio_orchestrator::usb_audio_orchestrator(audio_rb_controller* controller, size_t frameSize,
+                                               const audio_wait_config& waitConfig, size_t batchFrames,
+                                               const audio_signal_config& signalConfig,
+                                               const audio_pacing_config& pacingConfig,
+                                               const audio_microframe_format& microframeFormat,
+                                               const audio_timer_config& timerConfig,
+                                               const audio_trace_config& traceConfig)
+    : buffer_controller(controller), frame_size(frameSize), format(microframeFormat), capture(nullptr),
+      memory_locked(false) {
     
     if (!buffer_controller || !buffer_controller->isInitialized()) {
         LOG_ERROR("Cannot create orchestrator - buffer controller not initialized");
         return;
     }
-    
+
+    if (frame_size != buffer_controller->getFrameSize()) {
+        LOG_WARN("Orchestrator frame size " + std::to_string(frame_size) + " differs from ring slot size " +
+                 std::to_string(buffer_controller->getFrameSize()));
+    }
+
+    if (!format.isValid()) {
+        LOG_ERROR("Invalid microframe format (" + format.describe() + ") - using " + audio_microframe_format().describe());
+        format = audio_microframe_format();
+    }
+
+    // Packed payload per microframe, e.g. 96 kHz f32 stereo: 12 frames × 2 channels × 4 bytes = 96 bytes
+    size_t audioDataSize = format.getPayloadBytes();
+    if (audioDataSize > buffer_controller->getFrameSize()) {
+        LOG_ERROR("Microframe payload " + std::to_string(audioDataSize) + " bytes does not fit a " + 
+                  std::to_string(buffer_controller->getFrameSize()) + "-byte slot - packets will be truncated");
+    }
+
+    // The built-in signal renders at the wire rate and channel count
+    audio_signal_config laneSignal = signalConfig;
+    laneSignal.sampleRate = format.sampleRate;
+    laneSignal.channels = format.channels;
+
     // Create producer and consumer instances using concrete classes
-    // Calculate audio data size for 32-bit float samples
-    // For 96kHz, 32-bit, 2ch: 12 samples × 4 bytes × 2 channels = 96 bytes
-    size_t audioDataSize = 96;  // 32-bit float samples per microframe
-    producer = std::unique_ptr<iaudio_producer>(new usb_audio_producer(buffer_controller, frameSize, audioDataSize));
-    consumer = std::unique_ptr<iaudio_consumer>(new usb_audio_consumer(buffer_controller));
+    for (size_t lane = 0; lane < buffer_controller->getProducerLaneCount(); ++lane) {
+        producers.push_back(std::unique_ptr<iaudio_producer>(
+            new usb_audio_producer(buffer_controller, frameSize, audioDataSize, waitConfig, batchFrames, laneSignal,
+                                   pacingConfig, format)));
+    }
+    consumer = std::unique_ptr<iaudio_consumer>(new usb_audio_consumer(buffer_controller, format, timerConfig, traceConfig));
     
     LOG_INFO("🎵 USB Audio Class Simulator: " + std::to_string(frame_size) + " bytes/microframe, " + 
              std::to_string(buffer_controller->getBufferSize()) + " bytes buffer (" + 
              std::to_string(buffer_controller->getBufferSize() / frame_size) + " microframes capacity)");
+    LOG_INFO("🎵 Microframe format: " + format.describe() + ", " + std::to_string(audioDataSize) + 
+             " bytes payload, " + audio_convert_simd_name() + " converters");
 }
 
 usb_audio_orchestrator::~usb_audio_orchestrator() {
+    // mlockall stays in effect: munlockall would also drop the rings' own page locks
+    // and whatever else the process locked. Call audio_unlock_process_memory() to undo it
     stopStreaming();
 }
 
+bool usb_audio_orchestrator::setSource(iaudio_source* source, size_t lane) {
+    if (lane >= producers.size()) {
+        LOG_ERROR("Cannot set source - no producer on lane " + std::to_string(lane));
+        return false;
+    }
+    if (isStreaming()) {
+        LOG_ERROR("Cannot set source while streaming");
+        return false;
+    }
+    producers[lane]->setSource(source);
+    // The producer refuses a source it cannot pack and keeps the one it had
+    return !source || producers[lane]->getSource() == source;
+}
+
+bool usb_audio_orchestrator::setCapture(audio_capture_writer* writer) {
+    if (!consumer) {
+        LOG_ERROR("Cannot set capture - consumer not initialized");
+        return false;
+    }
+    if (isStreaming()) {
+        LOG_ERROR("Cannot set capture while streaming");
+        return false;
+    }
+    if (writer && !writer->isOpen()) {
+        LOG_ERROR("Cannot set capture - the capture file is not open");
+        return false;
+    }
+    capture = writer;
+    consumer->setCapture(writer);
+    return true;
+}
+
+bool usb_audio_orchestrator::setReplay(audio_capture_reader* reader, const audio_replay_config& replayConfig,
+                                       size_t lane) {
+    if (lane >= producers.size()) {
+        LOG_ERROR("Cannot set replay - no producer on lane " + std::to_string(lane));
+        return false;
+    }
+    if (isStreaming()) {
+        LOG_ERROR("Cannot set replay while streaming");
+        return false;
+    }
+    if (!reader || !reader->isOpen()) {
+        LOG_ERROR("Cannot set replay - no open capture");
+        return false;
+    }
+    if (reader->getFormat().describe() != format.describe()) {
+        LOG_WARN("Capture format " + reader->getFormat().describe() + " differs from the stream format " + 
+                 format.describe());
+    }
+    // The old producer releases its lane first so the replay can claim it
+    producers[lane].reset();
+    producers[lane] = std::unique_ptr<iaudio_producer>(new audio_replay_producer(buffer_controller, reader, replayConfig));
+    producers[lane]->setThreadPolicy(thread_config.producer);
+    return true;
+}
+
+bool usb_audio_orchestrator::setThreadConfig(const audio_thread_config& threadConfig) {
+    if (isStreaming()) {
+        LOG_ERROR("Cannot set thread policies while streaming");
+        return false;
+    }
+    thread_config = threadConfig;
+    for (size_t i = 0; i < producers.size(); ++i) {
+        producers[i]->setThreadPolicy(thread_config.producer);
+    }
+    if (consumer) consumer->setThreadPolicy(thread_config.consumer);
+    return true;
+}
+
 void usb_audio_orchestrator::startStreaming() {
-    if (!producer || !consumer) {
+    if (producers.empty() || !consumer) {
         LOG_ERROR("Cannot start streaming - producer or consumer not initialized");
         return;
     }
     
     LOG_INFO("🚀 Starting USB Audio Class simulation (125μs microframes)...");
     
+    // Before the threads start, so their stacks and everything they touch is locked as it is mapped
+    if (thread_config.lockAllMemory && !memory_locked) {
+        memory_locked = audio_lock_process_memory();
+    }
+    
     // Start consumer first to avoid initial underruns
     consumer->start();
-    producer->start();
+    for (size_t i = 0; i < producers.size(); ++i) {
+        producers[i]->start();
+    }
 }
 
 void usb_audio_orchestrator::stopStreaming() {
-    if (producer) producer->stop();
+    for (size_t i = 0; i < producers.size(); ++i) {
+        producers[i]->stop();
+    }
     if (consumer) consumer->stop();
     LOG_INFO("🛑 Streaming stopped");
 }
 
 bool usb_audio_orchestrator::isStreaming() const {
-    return (producer && producer->isRunning()) || (consumer && consumer->isRunning());
+    for (size_t i = 0; i < producers.size(); ++i) {
+        if (producers[i]->isRunning()) return true;
+    }
+    return consumer && consumer->isRunning();
 }
 
 void usb_audio_orchestrator::printStatistics() const {
     LOG_INFO("=== USB Audio Statistics ===");
     
-    if (producer) {
-        LOG_INFO("Total Frames Produced: " + std::to_string(producer->getTotalFramesProduced()));
-        LOG_INFO("Overruns: " + std::to_string(producer->getOverrunCount()));
+    // Producer figures are summed over all fan-in lanes
+    uint32_t produced = 0;
+    uint32_t overruns = 0;
+    uint64_t producerFaults = 0;
+    uint64_t producerAllocations = 0;
+    audio_wait_stats waitStats;
+    for (size_t i = 0; i < producers.size(); ++i) {
+        produced += producers[i]->getTotalFramesProduced();
+        overruns += producers[i]->getOverrunCount();
+        producerFaults += producers[i]->getPageFaultCount();
+        producerAllocations += producers[i]->getLoopAllocationCount();
+        audio_wait_stats laneStats = producers[i]->getWaitStats();
+        waitStats.waits += laneStats.waits;
+        waitStats.wakeups += laneStats.wakeups;
+        waitStats.totalWakeLatencyNs += laneStats.totalWakeLatencyNs;
+        if (laneStats.maxWakeLatencyNs > waitStats.maxWakeLatencyNs) {
+            waitStats.maxWakeLatencyNs = laneStats.maxWakeLatencyNs;
+        }
+    }
+    
+    if (!producers.empty()) {
+        if (producers.size() > 1) {
+            LOG_INFO("Producers: " + std::to_string(producers.size()) + " fan-in lanes");
+        }
+        LOG_INFO("Total Frames Produced: " + std::to_string(produced));
+        LOG_INFO("Overruns: " + std::to_string(overruns));
+        LOG_INFO("Producer Page Faults: " + std::to_string(producerFaults));
+        if (isAllocCounterEnabled()) {
+            LOG_INFO("Producer Steady-State Allocations: " + std::to_string(producerAllocations));
+        }
+        
+        LOG_INFO("Backpressure Waits: " + std::to_string(waitStats.waits) + 
+                 " (consumer wake-ups: " + std::to_string(waitStats.wakeups) + ")");
+        if (waitStats.wakeups > 0) {
+            LOG_INFO("Wake Latency: avg " + std::to_string(waitStats.totalWakeLatencyNs / waitStats.wakeups / 1000) + 
+                     "μs, max " + std::to_string(waitStats.maxWakeLatencyNs / 1000) + "μs");
+        }
+        
+        for (size_t i = 0; i < producers.size(); ++i) {
+            audio_thread_policy_result producerThread = producers[i]->getThreadPolicyResult();
+            if (!producerThread.applied) continue;
+            LOG_INFO("Producer Thread" + (producers.size() > 1 ? " (lane " + std::to_string(i) + ")" : std::string()) + 
+                     ": " + producerThread.describe() + (producerThread.fellBack ? " (fallback)" : ""));
+        }
+        
+        for (size_t i = 0; i < producers.size(); ++i) {
+            iaudio_source* source = producers[i]->getSource();
+            if (!source) continue;      // Replay lanes carry captured packets, not a source
+            LOG_INFO("Source" + (producers.size() > 1 ? " (lane " + std::to_string(i) + ")" : std::string()) + 
+                     ": " + source->getName() + ", starved microframes: " + std::to_string(source->getStarvedMicroframes()));
+        }
+        
+        for (size_t i = 0; i < producers.size(); ++i) {
+            audio_pacing_stats pacing = producers[i]->getPacingStats();
+            if (!pacing.enabled) continue;
+            LOG_INFO("Pacing" + (producers.size() > 1 ? " (lane " + std::to_string(i) + ")" : std::string()) + 
+                     ": target " + std::to_string(pacing.targetFill) + " microframes, fill " + 
+                     std::to_string(pacing.lastFill) + " (settled band " + std::to_string(pacing.minFill) + "-" + 
+                     std::to_string(pacing.maxFill) + "), rate " + std::to_string(pacing.rateHz) + " Hz");
+        }
     }
     
     if (consumer) {
         LOG_INFO("Total Frames Consumed: " + std::to_string(consumer->getTotalFramesConsumed()));
+        uint32_t microframes = consumer->getTotalFramesConsumed();
+        if (microframes > 0) {
+            // Mean packet × microframe rate: the sample rate actually delivered
+            double meanPacket = static_cast<double>(consumer->getTotalSamplesConsumed()) / microframes;
+            LOG_INFO("Samples Consumed: " + std::to_string(consumer->getTotalSamplesConsumed()) + " sample frames (" + 
+                     std::to_string(meanPacket) + " per microframe, " + 
+                     std::to_string(meanPacket * format.microframesPerSecond) + " Hz)");
+        }
         LOG_INFO("Underruns: " + std::to_string(consumer->getUnderrunCount()));
+        LOG_INFO("Consumer Page Faults: " + std::to_string(consumer->getPageFaultCount()));
+        
+        // Jitter of the 125μs cadence itself: what decides whether a real device would glitch
+        audio_latency_snapshot wakeups = consumer->getWakeupLateness();
+        if (wakeups.samples > 0) {
+            LOG_INFO("Consumer Wake-up Lateness: p50 " + std::to_string(wakeups.percentileNs(50.0) / 1000) + 
+                     "μs, p99 " + std::to_string(wakeups.percentileNs(99.0) / 1000) + 
+                     "μs, p99.9 " + std::to_string(wakeups.percentileNs(99.9) / 1000) + 
+                     "μs, max " + std::to_string(wakeups.maxNs / 1000) + "μs (" + 
+                     std::to_string(wakeups.samples) + " wake-ups, " + 
+                     std::to_string(consumer->getWakeupOversleeps()) + " past the spin margin)");
+        }
+        audio_thread_policy_result consumerThread = consumer->getThreadPolicyResult();
+        if (consumerThread.applied) {
+            LOG_INFO("Consumer Thread: " + consumerThread.describe() + (consumerThread.fellBack ? " (fallback)" : ""));
+        }
+        if (capture) {
+            LOG_INFO("Capture: " + std::to_string(capture->getRecordsWritten()) + " microframes written, " + 
+                     std::to_string(capture->getRecordsDropped()) + " dropped, " + 
+                     std::to_string(capture->getBytesWritten()) + " bytes");
+        }
+        
+        audio_latency_snapshot latency = consumer->getLatencySnapshot();
+        if (latency.samples > 0) {
+            LOG_INFO("Frame Latency: p50 " + std::to_string(latency.percentileNs(50.0) / 1000) + 
+                     "μs, p99 " + std::to_string(latency.percentileNs(99.0) / 1000) + 
+                     "μs, p99.9 " + std::to_string(latency.percentileNs(99.9) / 1000) + 
+                     "μs, max " + std::to_string(latency.maxNs / 1000) + "μs (" + 
+                     std::to_string(latency.samples) + " frames)");
+            LOG_INFO("Sequence Gaps: " + std::to_string(latency.gaps) + " (" + 
+                     std::to_string(latency.lostFrames) + " frames lost), reordered " + 
+                     std::to_string(latency.reordered));
+        }
     }
     
-    if (producer && consumer) {
-        uint32_t produced = producer->getTotalFramesProduced();
+    if (!producers.empty() && consumer) {
         uint32_t consumed = consumer->getTotalFramesConsumed();
         
         if (produced > 0) {
@@ -74,10 +288,23 @@ void usb_audio_orchestrator::printStatistics() const {
             LOG_INFO("Underrun Rate: " + std::to_string(underrun_rate) + "%");
         }
         if (consumed > 0) {
-            double overrun_rate = (double)producer->getOverrunCount() / consumed * 100.0;
+            double overrun_rate = (double)overruns / consumed * 100.0;
             LOG_INFO("Overrun Rate: " + std::to_string(overrun_rate) + "%");
         }
     }
+    
+    if (buffer_controller && buffer_controller->isInitialized()) {
+        audio_fill_snapshot fill = buffer_controller->getFillTelemetry().snapshot();
+        LOG_INFO("Ring Fill: current " + std::to_string(fill.currentFill) + "/" + std::to_string(fill.capacity) + 
+                 " microframes, interval min " + std::to_string(fill.intervalMinFill) + 
+                 ", max " + std::to_string(fill.intervalMaxFill));
+        
+        std::string histogram;
+        for (size_t i = 0; i < audio_fill_snapshot::HISTOGRAM_BUCKETS; ++i) {
+            histogram += (i == 0 ? "" : " ") + std::to_string(fill.histogram[i]);
+        }
+        LOG_INFO("Ring Fill Histogram (" + std::to_string(fill.samples) + " reads): " + histogram);
+    }
 }
 
 } // namespace kcobain 
\ No newline at end of file
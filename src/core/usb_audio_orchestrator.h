@@ -1,28 +1,62 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include "audio_rb_controller.h"
 #include "iaudio_producer.h"
 #include "iaudio_consumer.h"
+#include "audio_wait_strategy.h"
+#include "audio_signal_generator.h"
+#include "audio_rate_controller.h"
+#include "iaudio_source.h"
+#include "audio_sample_format.h"
+#include "audio_capture.h"
+#include "audio_replay_producer.h"
+#include "audio_precise_timer.h"
+#include "audio_thread_policy.h"
+#include "audio_trace.h"
 
 namespace kcobain {
 
 /**
  * @brief Audio Streaming Orchestrator
- * Manages the producer and consumer components
+ * Manages the producer and consumer components; a fan-in controller gets
+ * one producer per lane, all feeding the same consumer.
  */
 class usb_audio_orchestrator {
 private:
     audio_rb_controller* buffer_controller;  // Pointer to external controller
-    std::unique_ptr<iaudio_producer> producer;
+    std::vector<std::unique_ptr<iaudio_producer> > producers;
     std::unique_ptr<iaudio_consumer> consumer;
     
     size_t frame_size;
+    audio_microframe_format format;
+    audio_capture_writer* capture;           // Not owned
+    audio_thread_config thread_config;
+    bool memory_locked;                      // This orchestrator called mlockall (never undone here)
 
 public:
-    usb_audio_orchestrator(audio_rb_controller* controller, size_t frameSize = 384);
+    usb_audio_orchestrator(audio_rb_controller* controller, size_t frameSize = 384,
+                           const audio_wait_config& waitConfig = audio_wait_config(), size_t batchFrames = 8,
+                           const audio_signal_config& signalConfig = audio_signal_config(),
+                           const audio_pacing_config& pacingConfig = audio_pacing_config(),
+                           const audio_microframe_format& microframeFormat = audio_microframe_format(),
+                           const audio_timer_config& timerConfig = audio_timer_config(),
+                           const audio_trace_config& traceConfig = audio_trace_config());
     ~usb_audio_orchestrator();
     
+    // Feed a producer lane from an external source (e.g. audio_file_source) instead of its test signal;
+    // the source must outlive streaming
+    bool setSource(iaudio_source* source, size_t lane = 0);
+    // Record every microframe the consumer reads; the writer must be open and outlive streaming (null stops)
+    bool setCapture(audio_capture_writer* writer);
+    // Replace a lane's producer with a replay of an open capture (which must outlive streaming)
+    bool setReplay(audio_capture_reader* reader, const audio_replay_config& replayConfig = audio_replay_config(),
+                   size_t lane = 0);
+    
+    // Scheduling class, affinity and stack prefault for the streaming threads, plus optional mlockall
+    bool setThreadConfig(const audio_thread_config& threadConfig);
+    
     void startStreaming();
     void stopStreaming();
     bool isStreaming() const;
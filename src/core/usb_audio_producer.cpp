@@ -1,32 +1,93 @@
 #include "usb_audio_producer.h"
 #include "audio_rb_controller.h"
 #include "../../include/kcobain/logger.h"
+#include "../../include/kcobain/alloc_counter.h"
 #include "../../external/miniaudio.h"
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 namespace kcobain {
 
-usb_audio_producer::usb_audio_producer(audio_rb_controller* controller, size_t frameSize, size_t audioDataSize)
+usb_audio_producer::usb_audio_producer(audio_rb_controller* controller, size_t frameSize, size_t audioDataSize,
+                                       const audio_wait_config& waitConfig, size_t batchFrames,
+                                       const audio_signal_config& signalConfig,
+                                       const audio_pacing_config& pacingConfig,
+                                       const audio_microframe_format& microframeFormat)
     : buffer_controller(controller), running(false), frame_size(frameSize), audio_data_size(audioDataSize),
-      gen(rd()), audio_dist(-1.0f, 1.0f), total_frames_produced(0), overrun_count(0) {
+      format(microframeFormat), source(&generator), total_frames_produced(0), overrun_count(0), page_fault_count(0), loop_allocations(0),
+      wait_config(waitConfig), batch_frames(batchFrames > 0 ? batchFrames : 1), lane(-1),
+      backpressure_waits(0), wakeup_count(0), wake_latency_total_ns(0), wake_latency_max_ns(0),
+      pacing_fill(0), pacing_min_fill(0), pacing_max_fill(0), pacing_rate_mhz(0), pacing_ticks(0) {
+    
+    if (!generator.initialize(signalConfig)) {
+        LOG_WARN("Producer falling back to the default noise signal");
+    }
+    if (!format.isValid()) {
+        LOG_WARN("Producer falling back to the default microframe format");
+        format = audio_microframe_format();
+    }
+    packer.initialize(format, batch_frames);
     
     if (!buffer_controller || !buffer_controller->isInitialized()) {
         LOG_ERROR("Producer cannot be created - invalid or uninitialized buffer controller");
+    } else {
+        if (batch_frames > buffer_controller->getFrameCapacity()) {
+            // A batch larger than the ring could never be satisfied by a single wait
+            batch_frames = buffer_controller->getFrameCapacity();
+        }
+        
+        // A setpoint at capacity could never be held below full
+        audio_pacing_config pacing = pacingConfig;
+        size_t capacity = buffer_controller->getFrameCapacity();
+        if (pacing.enabled && pacing.targetFillFrames + batch_frames > capacity) {
+            pacing.targetFillFrames = static_cast<uint32_t>(capacity > batch_frames ? capacity - batch_frames : 1);
+            LOG_WARN("Pacing setpoint clamped to " + std::to_string(pacing.targetFillFrames) + 
+                     " microframes for a " + std::to_string(capacity) + "-microframe ring");
+        }
+        if (pacing.tickMicros == 0) pacing.tickMicros = 1;
+        pacer.initialize(pacing);
+        
+        // Each producer writes its own SPSC lane; two producers never share a ring
+        lane = buffer_controller->claimProducerLane();
+        if (lane < 0) {
+            LOG_ERROR("Producer cannot be created - all " + std::to_string(buffer_controller->getProducerLaneCount()) + 
+                      " producer lanes are taken");
+        }
     }
     
     LOG_INFO("📤 Producer: USB frame=" + std::to_string(frameSize) + " bytes, Audio data=" + 
-             std::to_string(audioDataSize) + " bytes per microframe");
+             std::to_string(audioDataSize) + " bytes per microframe, batch=" + 
+             std::to_string(batch_frames) + " microframes, format=" + format.describe() + ", signal=" + 
+             audio_signal_generator::getTypeName(generator.getConfig().type));
+    if (packer.getScheduler().isFractional()) {
+        LOG_INFO("📤 Producer packets alternate " + std::to_string(packer.getScheduler().getMinFrames()) + "/" + 
+                 std::to_string(packer.getScheduler().getMaxFrames()) + " sample frames per microframe");
+    }
+    if (pacer.getConfig().enabled) {
+        LOG_INFO("📤 Producer paced: target fill " + std::to_string(pacer.getConfig().targetFillFrames) + 
+                 " microframes, tick " + std::to_string(pacer.getConfig().tickMicros) + "μs");
+    }
 }
 
 usb_audio_producer::~usb_audio_producer() {
     stop();
+    if (buffer_controller && lane >= 0) {
+        buffer_controller->releaseProducerLane(lane);
+    }
 }
 
 void usb_audio_producer::start() {
     if (running.load()) return;
     
-    if (!buffer_controller || !buffer_controller->isInitialized()) {
-        LOG_ERROR("Cannot start producer - no valid buffer controller");
+    if (!buffer_controller || !buffer_controller->isInitialized() || lane < 0) {
+        LOG_ERROR("Cannot start producer - no valid buffer controller lane");
+        return;
+    }
+    
+    // Sources with background work (decoders) get it going before the first microframe
+    if (!source->start()) {
+        LOG_ERROR("Cannot start producer - source " + std::string(source->getName()) + " failed to start");
         return;
     }
     
@@ -42,6 +103,7 @@ void usb_audio_producer::stop() {
     if (producer_thread.joinable()) {
         producer_thread.join();
     }
+    source->stop();
     LOG_INFO("📤 USB Audio Producer stopped");
 }
 
@@ -57,61 +119,224 @@ uint32_t usb_audio_producer::getOverrunCount() const {
     return overrun_count.load();
 }
 
+uint64_t usb_audio_producer::getPageFaultCount() const {
+    return page_fault_count.load();
+}
+
+uint64_t usb_audio_producer::getLoopAllocationCount() const {
+    return loop_allocations.load();
+}
+
+audio_wait_stats usb_audio_producer::getWaitStats() const {
+    audio_wait_stats stats;
+    stats.waits = backpressure_waits.load();
+    stats.wakeups = wakeup_count.load();
+    stats.totalWakeLatencyNs = wake_latency_total_ns.load();
+    stats.maxWakeLatencyNs = wake_latency_max_ns.load();
+    return stats;
+}
+
+void usb_audio_producer::setSource(iaudio_source* externalSource) {
+    if (running.load()) {
+        LOG_ERROR("Cannot change producer source while streaming");
+        return;
+    }
+    if (!packer.accepts(externalSource)) {
+        LOG_ERROR("Producer keeps its current source");
+        return;
+    }
+    source = externalSource ? externalSource : &generator;
+    LOG_INFO("📤 Producer source: " + std::string(source->getName()));
+}
+
+iaudio_source* usb_audio_producer::getSource() const {
+    return source;
+}
+
+void usb_audio_producer::setThreadPolicy(const audio_thread_policy& policy) {
+    if (running.load()) {
+        LOG_ERROR("Cannot change producer thread policy while streaming");
+        return;
+    }
+    thread_policy = policy;
+}
+
+audio_thread_policy_result usb_audio_producer::getThreadPolicyResult() const {
+    std::lock_guard<std::mutex> lock(thread_result_lock);
+    return thread_result;
+}
+
+audio_pacing_stats usb_audio_producer::getPacingStats() const {
+    audio_pacing_stats stats;
+    stats.enabled = pacer.getConfig().enabled;
+    stats.targetFill = pacer.getConfig().targetFillFrames;
+    stats.lastFill = pacing_fill.load();
+    stats.minFill = pacing_min_fill.load();
+    stats.maxFill = pacing_max_fill.load();
+    stats.rateHz = static_cast<double>(pacing_rate_mhz.load()) / 1000.0;
+    stats.ticks = pacing_ticks.load();
+    return stats;
+}
+
+double usb_audio_producer::paceTick(audio_frame_ring* ring, double elapsedSeconds, bool* pSettled) {
+    // Occupancy as the consumer sees it; read from the ring itself so it also
+    // holds for a consumer in another process and for each fan-in lane
+    uint32_t fill = static_cast<uint32_t>(ring->availableRead() / ring->getFrameSize());
+    double rateHz = pacer.update(fill, elapsedSeconds);
+    
+    pacing_fill.store(fill, std::memory_order_relaxed);
+    pacing_rate_mhz.store(static_cast<uint64_t>(rateHz * 1000.0), std::memory_order_relaxed);
+    pacing_ticks.fetch_add(1, std::memory_order_relaxed);
+    
+    // The start-up ramp is not steady state; track the band from the first time the setpoint is reached
+    if (!*pSettled && fill >= pacer.getConfig().targetFillFrames) {
+        *pSettled = true;
+        pacing_min_fill.store(fill, std::memory_order_relaxed);
+        pacing_max_fill.store(fill, std::memory_order_relaxed);
+    } else if (*pSettled) {
+        if (fill < pacing_min_fill.load(std::memory_order_relaxed)) pacing_min_fill.store(fill, std::memory_order_relaxed);
+        if (fill > pacing_max_fill.load(std::memory_order_relaxed)) pacing_max_fill.store(fill, std::memory_order_relaxed);
+    }
+    return rateHz;
+}
+
+void usb_audio_producer::waitForSpace(audio_frame_ring* ring) {
+    backpressure_waits.fetch_add(1, std::memory_order_relaxed);
+    
+    int64_t wakeLatencyNs = -1;
+    ring->waitForWritable(batch_frames, wait_config, &wakeLatencyNs);
+    if (wakeLatencyNs >= 0) {
+        uint64_t latency = static_cast<uint64_t>(wakeLatencyNs);
+        wakeup_count.fetch_add(1, std::memory_order_relaxed);
+        wake_latency_total_ns.fetch_add(latency, std::memory_order_relaxed);
+        if (latency > wake_latency_max_ns.load(std::memory_order_relaxed)) {
+            wake_latency_max_ns.store(latency, std::memory_order_relaxed);
+        }
+    }
+}
+
 void usb_audio_producer::producerLoop() {
-    ma_rb* ring_buffer = buffer_controller->getRingBuffer();
+    audio_frame_ring* ring_buffer = buffer_controller->getWriteRing(static_cast<size_t>(lane));
     if (!ring_buffer) {
         LOG_ERROR("Producer cannot start - no ring buffer available");
         return;
     }
     
+    audio_thread_policy_result policyResult = audio_apply_thread_policy(thread_policy, "Producer");
+    {
+        std::lock_guard<std::mutex> lock(thread_result_lock);
+        thread_result = policyResult;
+    }
+    
+    // Faults from here on are taken on the real-time path
+    audio_page_faults loopStartFaults = audio_ring_memory::getThreadPageFaults();
+    bool consumerLost = false;
+    uint64_t sequence = 0;
+    const uint64_t WARMUP_BATCHES = 64;
+    uint64_t batchCount = 0;
+    uint64_t warmAllocations = 0;
+    
+    // Paced mode: frames are owed at the controller's rate; the fraction carries over between ticks
+    const bool paced = pacer.getConfig().enabled;
+    const std::chrono::microseconds tickPeriod(pacer.getConfig().tickMicros);
+    std::chrono::steady_clock::time_point lastTick = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point nextTick = lastTick;
+    double owedFrames = pacer.getConfig().targetFillFrames;   // Prime the ring to the setpoint
+    bool settled = false;
+    
     while (running.load()) {
-        // Generate 32-bit float audio data
-        size_t numSamples = audio_data_size / sizeof(float);
-        std::vector<float> audioSamples(numSamples);
-        for (size_t i = 0; i < numSamples; ++i) {
-            audioSamples[i] = audio_dist(gen);  // Generate float between -1.0 and 1.0
+        // Microframe boundary: pick up a live resize if one is queued (lane 0 only, fan-in rings are fixed)
+        if (lane == 0) {
+            ring_buffer = buffer_controller->syncWriteRing(ring_buffer);
         }
+        buffer_controller->heartbeat();
+        const size_t slotSize = ring_buffer->getFrameSize();
+        const size_t payloadBytes = std::min(std::min(audio_data_size, frame_size), slotSize);
         
-        // Convert float samples to bytes for USB transport
-        std::vector<uint8_t> audioData(audio_data_size);
-        std::memcpy(audioData.data(), audioSamples.data(), audio_data_size);
+        // Paced: once the owed frames are written, sleep to the next tick and run the control step
+        if (paced && owedFrames < 1.0) {
+            nextTick += tickPeriod;
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (nextTick < now - tickPeriod * 4) {
+                nextTick = now;     // Fell far behind (stall, suspend): resync instead of bursting
+            }
+            std::this_thread::sleep_until(nextTick);
+            now = std::chrono::steady_clock::now();
+            double elapsedSeconds = std::chrono::duration<double>(now - lastTick).count();
+            lastTick = now;
+            owedFrames += paceTick(ring_buffer, elapsedSeconds, &settled) * elapsedSeconds;
+            // Never owe more than the ring can hold
+            owedFrames = std::min(owedFrames, static_cast<double>(ring_buffer->getFrameCount()));
+            continue;
+        }
+        const size_t framesWanted = paced ? std::min(batch_frames, static_cast<size_t>(owedFrames))
+                                          : batch_frames;
         
-        // Create USB microframe with padding if needed
-        std::vector<uint8_t> usbFrame(frame_size, 0);  // Initialize with zeros
-        size_t bytesToCopy = std::min(audio_data_size, frame_size);
-        std::copy(audioData.begin(), audioData.begin() + bytesToCopy, usbFrame.begin());
+        // Acquire up to one batch of whole microframes; a full ring is backpressure,
+        // so park until a whole batch is free and catch up in bulk
+        void* writeBuffer = nullptr;
+        size_t framesAcquired = 0;
+        ma_result result = MA_SUCCESS;
+        while (running.load()) {
+            framesAcquired = framesWanted;
+            result = ring_buffer->acquireWriteFrames(&framesAcquired, &writeBuffer);
+            if (result != MA_SUCCESS || framesAcquired > 0) {
+                break;
+            }
+            waitForSpace(ring_buffer);
+            buffer_controller->heartbeat();
+            
+            // A full ring with a dead consumer process will never drain
+            if (!consumerLost && buffer_controller->isPeerGone()) {
+                consumerLost = true;
+                LOG_ERROR("Consumer process is gone - shared ring will not drain");
+            }
+        }
+        
+        if (result != MA_SUCCESS) {
+            // A genuine overrun: the ring refused the frames and they are dropped
+            overrun_count.fetch_add(1);
+            LOG_WARN("Overrun detected - dropping frame (result: " + std::to_string(result) + ")");
+            continue;
+        }
         
-        // Write USB frame to miniaudio ring buffer
-        size_t bytesToWrite = frame_size;
-        void* writeBuffer;
-        size_t bytesAcquired = bytesToWrite;
-        ma_result result = ma_rb_acquire_write(ring_buffer, &bytesAcquired, &writeBuffer);
+        // Generate the whole batch into the acquired slots (integer formats and
+        // variable-length packets through the packer's preallocated scratch): no heap
+        packer.pack(source, static_cast<uint8_t*>(writeBuffer), framesAcquired, slotSize, payloadBytes);
         
-        // Debug: Log what's happening
-        static int writeAttempts = 0;
-        writeAttempts++;
-        if (writeAttempts % 1000 == 0) {
-            LOG_INFO("Write attempt #" + std::to_string(writeAttempts) + 
-                     " - result: " + std::to_string(result) + 
-                     ", bytesAcquired: " + std::to_string(bytesAcquired));
+        // Stamp the batch just before it becomes visible to the consumer
+        if (ring_buffer->hasFrameMeta()) {
+            int64_t commitTimeNs = audio_steady_time_ns();
+            for (size_t frame = 0; frame < framesAcquired; ++frame) {
+                audio_frame_meta* meta = ring_buffer->getFrameMeta(static_cast<uint8_t*>(writeBuffer) + frame * slotSize);
+                meta->sequence = sequence++;
+                meta->timestamp_ns = commitTimeNs;
+                meta->payload_bytes = packer.getPacketBytes(frame);
+            }
         }
         
-        if (result == MA_SUCCESS && bytesAcquired > 0) {
-            memcpy(writeBuffer, usbFrame.data(), bytesAcquired);
-            ma_rb_commit_write(ring_buffer, bytesAcquired);
-            total_frames_produced.fetch_add(1);
-            
-            // Check if we're exceeding expected capacity
-            uint32_t maxFrames = buffer_controller->getBufferSize() / frame_size;
-            if (total_frames_produced.load() > maxFrames) {
-                LOG_WARN("Buffer capacity exceeded: " + std::to_string(total_frames_produced.load()) + 
-                         " frames produced (max: " + std::to_string(maxFrames) + ")");
+        // One commit and one counter update for the whole batch
+        if (framesAcquired > 0) {
+            ring_buffer->commitWriteFrames(framesAcquired);
+            total_frames_produced.fetch_add(static_cast<uint32_t>(framesAcquired));
+            if (paced) {
+                owedFrames -= static_cast<double>(framesAcquired);
             }
-        } else if (result != MA_SUCCESS) {
-            overrun_count.fetch_add(1);
-            LOG_WARN("Overrun detected - buffer full, dropping frame (result: " + std::to_string(result) + ")");
         }
+        
+        // Steady state starts once the first batches have been through the ring
+        if (++batchCount == WARMUP_BATCHES) {
+            warmAllocations = getThreadAllocCount();
+        }
+    }
+    
+    if (batchCount >= WARMUP_BATCHES) {
+        loop_allocations.store(getThreadAllocCount() - warmAllocations);
     }
+    
+    audio_page_faults loopEndFaults = audio_ring_memory::getThreadPageFaults();
+    page_fault_count.store((loopEndFaults.minor - loopStartFaults.minor) + 
+                           (loopEndFaults.major - loopStartFaults.major));
 }
 
 } // namespace kcobain
\ No newline at end of file
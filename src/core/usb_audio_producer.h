@@ -1,14 +1,18 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
 #include <thread>
-#include <random>
-#include <vector>
 #include "iaudio_producer.h"
+#include "audio_wait_strategy.h"
+#include "audio_signal_generator.h"
+#include "audio_rate_controller.h"
+#include "audio_microframe_packer.h"
 
 // Forward declaration
 namespace kcobain {
     class audio_rb_controller;
+    class audio_frame_ring;
 }
 
 namespace kcobain {
@@ -24,14 +28,37 @@ private:
     std::thread producer_thread;
     size_t frame_size;  // USB microframe size (384 bytes)
     size_t audio_data_size;  // Actual audio data size per microframe
-    std::random_device rd;
-    std::mt19937 gen;
-    std::uniform_real_distribution<float> audio_dist;
+    audio_microframe_format format;          // Wire format of the payload
+    audio_microframe_packer packer;          // Packet schedule and format conversion
+    audio_signal_generator generator;        // Built-in test signal
+    iaudio_source* source;                   // What gets packed into the slots (not owned)
     std::atomic<uint32_t> total_frames_produced;
     std::atomic<uint32_t> overrun_count;
+    std::atomic<uint64_t> page_fault_count;  // Faults taken inside the streaming loop
+    std::atomic<uint64_t> loop_allocations;  // Heap allocations after warm-up (alloc counter builds)
+    audio_wait_config wait_config;           // How to wait when the ring is full
+    size_t batch_frames;                     // Microframes acquired/committed per batch
+    int lane;                                // Controller lane this producer owns (-1 = none)
+    std::atomic<uint64_t> backpressure_waits;
+    std::atomic<uint64_t> wakeup_count;
+    std::atomic<uint64_t> wake_latency_total_ns;
+    std::atomic<uint64_t> wake_latency_max_ns;
+    audio_rate_controller pacer;             // Fill-level PI loop (paced mode only)
+    std::atomic<uint32_t> pacing_fill;
+    std::atomic<uint32_t> pacing_min_fill;
+    std::atomic<uint32_t> pacing_max_fill;
+    std::atomic<uint64_t> pacing_rate_mhz;   // Production rate in millihertz
+    std::atomic<uint64_t> pacing_ticks;
+    audio_thread_policy thread_policy;       // Scheduling, affinity and stack prefault for producer_thread
+    audio_thread_policy_result thread_result;
+    mutable std::mutex thread_result_lock;   // thread_result is written by producer_thread
 
 public:
-    usb_audio_producer(audio_rb_controller* controller, size_t frameSize = 384, size_t audioDataSize = 96);
+    usb_audio_producer(audio_rb_controller* controller, size_t frameSize = 384, size_t audioDataSize = 96,
+                       const audio_wait_config& waitConfig = audio_wait_config(), size_t batchFrames = 8,
+                       const audio_signal_config& signalConfig = audio_signal_config(),
+                       const audio_pacing_config& pacingConfig = audio_pacing_config(),
+                       const audio_microframe_format& microframeFormat = audio_microframe_format());
     ~usb_audio_producer();
     
     void start() override;
@@ -39,9 +66,19 @@ public:
     bool isRunning() const override;
     uint32_t getTotalFramesProduced() const override;
     uint32_t getOverrunCount() const override;
+    uint64_t getPageFaultCount() const override;
+    uint64_t getLoopAllocationCount() const override;
+    audio_wait_stats getWaitStats() const override;
+    audio_pacing_stats getPacingStats() const override;
+    void setSource(iaudio_source* externalSource) override;
+    iaudio_source* getSource() const override;
+    void setThreadPolicy(const audio_thread_policy& policy) override;
+    audio_thread_policy_result getThreadPolicyResult() const override;
 
 private:
     void producerLoop();
+    void waitForSpace(audio_frame_ring* ring);
+    double paceTick(audio_frame_ring* ring, double elapsedSeconds, bool* pSettled);   // Returns the new rate in Hz
 };
 
 } // namespace kcobain 
\ No newline at end of file
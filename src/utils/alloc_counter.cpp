@@ -0,0 +1,92 @@
+#include "../../include/kcobain/alloc_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace kcobain {
+
+#ifdef KCOBAIN_ALLOC_COUNTER
+
+namespace {
+
+thread_local uint64_t thread_alloc_count = 0;
+std::atomic<uint64_t> total_alloc_count(0);
+
+void* countedAlloc(std::size_t size) {
+    ++thread_alloc_count;
+    total_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size > 0 ? size : 1);
+}
+
+} // namespace
+
+bool isAllocCounterEnabled() {
+    return true;
+}
+
+uint64_t getThreadAllocCount() {
+    return thread_alloc_count;
+}
+
+uint64_t getTotalAllocCount() {
+    return total_alloc_count.load(std::memory_order_relaxed);
+}
+
+#else
+
+bool isAllocCounterEnabled() {
+    return false;
+}
+
+uint64_t getThreadAllocCount() {
+    return 0;
+}
+
+uint64_t getTotalAllocCount() {
+    return 0;
+}
+
+#endif
+
+} // namespace kcobain
+
+#ifdef KCOBAIN_ALLOC_COUNTER
+
+// Global replacements: every new/new[] goes through the counter
+void* operator new(std::size_t size) {
+    void* p = kcobain::countedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    void* p = kcobain::countedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return kcobain::countedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return kcobain::countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+#endif